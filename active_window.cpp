@@ -0,0 +1,141 @@
+#include <X11/Xatom.h>
+#include <X11/Xutil.h>
+
+#include "active_window.hpp"
+#include "trace.hpp"
+
+namespace active_window {
+
+namespace {
+
+Display* tracker_display = nullptr;
+XErrorHandler previous_error_handler = nullptr;
+
+// The active window can be destroyed before its class is read, so errors
+// on the tracker connection are expected and ignored.
+int ignore_tracker_errors(Display* dpy, XErrorEvent* error)
+{
+    if (dpy == tracker_display)
+    {
+        return 0;
+    }
+    return previous_error_handler ? previous_error_handler(dpy, error) : 0;
+}
+
+} // namespace
+
+tracker::tracker()
+    : dpy(nullptr), net_active_window(None), name(), window_class()
+{
+}
+
+tracker::~tracker()
+{
+    if (dpy)
+    {
+        XSetErrorHandler(previous_error_handler);
+        tracker_display = nullptr;
+        XCloseDisplay(dpy);
+    }
+}
+
+bool tracker::open()
+{
+    dpy = XOpenDisplay(nullptr);
+    if (!dpy)
+    {
+        return false;
+    }
+
+    tracker_display = dpy;
+    previous_error_handler = XSetErrorHandler(ignore_tracker_errors);
+
+    net_active_window = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
+    XSelectInput(dpy, DefaultRootWindow(dpy), PropertyChangeMask);
+
+    update();
+    XFlush(dpy);
+    return true;
+}
+
+int tracker::fd() const
+{
+    return ConnectionNumber(dpy);
+}
+
+bool tracker::dispatch()
+{
+    JOY2MOUSE_TRACE_SCOPE("active_window");
+
+    bool changed = false;
+    while (XPending(dpy))
+    {
+        bool active_changed = false;
+        while (XPending(dpy))
+        {
+            XEvent event;
+            XNextEvent(dpy, &event);
+            if (event.type == PropertyNotify &&
+                event.xproperty.atom == net_active_window)
+            {
+                active_changed = true;
+            }
+        }
+
+        if (active_changed && update())
+        {
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool tracker::update()
+{
+    Atom type;
+    int format;
+    unsigned long count;
+    unsigned long bytes_after;
+    unsigned char* data = nullptr;
+
+    Window active = None;
+    if (XGetWindowProperty(dpy, DefaultRootWindow(dpy), net_active_window, 0,
+                           1, False, XA_WINDOW, &type, &format, &count,
+                           &bytes_after, &data) == Success)
+    {
+        if (type == XA_WINDOW && format == 32 && count == 1)
+        {
+            active = *reinterpret_cast<Window*>(data);
+        }
+        XFree(data);
+    }
+
+    std::string new_name;
+    std::string new_class;
+
+    XClassHint hint = {};
+    if (active != None && XGetClassHint(dpy, active, &hint))
+    {
+        if (hint.res_name)
+        {
+            new_name = hint.res_name;
+            XFree(hint.res_name);
+        }
+        if (hint.res_class)
+        {
+            new_class = hint.res_class;
+            XFree(hint.res_class);
+        }
+    }
+
+    if (new_name == name && new_class == window_class)
+    {
+        return false;
+    }
+
+    name = std::move(new_name);
+    window_class = std::move(new_class);
+    return true;
+}
+
+} // namespace active_window
@@ -0,0 +1,56 @@
+#ifndef JOY2MOUSE_ACTIVE_WINDOW_HPP
+#define JOY2MOUSE_ACTIVE_WINDOW_HPP
+
+#include <X11/Xlib.h>
+
+#include <string>
+
+namespace active_window {
+
+// Follows the WM_CLASS of the active window by listening for PropertyNotify
+// on the root window's _NET_ACTIVE_WINDOW, so nothing is queried per input
+// event.
+//
+// Uses its own display connection, so its event queue cannot be filled
+// behind the back of epoll by requests made on the output connection.
+class tracker
+{
+public:
+    tracker();
+    ~tracker();
+
+    tracker(const tracker&) = delete;
+    tracker& operator= (const tracker&) = delete;
+
+    // Connects to the default display and reads the current active window.
+    bool open();
+
+    // File descriptor to wait on for changes.
+    int fd() const;
+
+    // Handles all pending X events. Returns true if the WM_CLASS of the
+    // active window changed.
+    bool dispatch();
+
+    const std::string& res_name() const
+    {
+        return name;
+    }
+
+    const std::string& res_class() const
+    {
+        return window_class;
+    }
+
+private:
+    bool update();
+
+    Display* dpy;
+    Atom net_active_window;
+    std::string name;
+    std::string window_class;
+};
+
+} // namespace active_window
+
+#endif // !defined(JOY2MOUSE_ACTIVE_WINDOW_HPP)
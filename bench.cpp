@@ -0,0 +1,218 @@
+// Microbenchmarks for the per-event and per-tick hot paths.
+//
+// Built on Google Benchmark; use --benchmark_repetitions for stable
+// statistics and --benchmark_format=json (or --benchmark_out) for
+// machine-readable results.
+
+#include <linux/joystick.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include "filter.hpp"
+#include "output.hpp"
+#include "pipeline.hpp"
+#include "vec.hpp"
+#include "xbox360_controller.hpp"
+
+namespace {
+
+using pipeline::clock_type;
+using xbox360_controller::axis;
+using xbox360_controller::button;
+
+js_event make_event(std::uint8_t type, int number, int value)
+{
+    js_event ev;
+    ev.time = 0;
+    ev.value = value;
+    ev.type = type;
+    ev.number = number;
+    return ev;
+}
+
+void set_axis(pipeline::translator& translator, axis axis, int value)
+{
+    js_event ev = make_event(JS_EVENT_AXIS, int(axis), value);
+    translator.handle_event(ev);
+}
+
+void BM_vec_length(benchmark::State& state)
+{
+    math::vec2f v = { 12345.0f, -23456.0f };
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(v);
+        benchmark::DoNotOptimize(v.length());
+    }
+}
+BENCHMARK(BM_vec_length);
+
+void BM_vec_normalized(benchmark::State& state)
+{
+    math::vec2f v = { 12345.0f, -23456.0f };
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(v);
+        benchmark::DoNotOptimize(v.normalized());
+    }
+}
+BENCHMARK(BM_vec_normalized);
+
+void BM_vec_scale(benchmark::State& state)
+{
+    math::vec2f v = { 0.25f, -0.5f };
+    float scalar = 37.5f;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(v);
+        benchmark::DoNotOptimize(scalar);
+        benchmark::DoNotOptimize(scalar * v);
+    }
+}
+BENCHMARK(BM_vec_scale);
+
+// Argument 0 leaves every input inside its dead zone, 1 deflects them all.
+void BM_process_dead_zone(benchmark::State& state)
+{
+    xbox360_controller::input_state input = {};
+    if (state.range(0))
+    {
+        input.uncorrected.left_stick = { 20000.0f, -15000.0f };
+        input.uncorrected.right_stick = { -9000.0f, 30000.0f };
+        input.uncorrected.left_trigger = 12000.0f;
+        input.uncorrected.right_trigger = -32767.0f;
+    }
+    else
+    {
+        input.uncorrected.left_stick = { 1200.0f, -800.0f };
+        input.uncorrected.right_stick = { -300.0f, 2500.0f };
+    }
+
+    for (auto _ : state)
+    {
+        input.process_dead_zone();
+        benchmark::DoNotOptimize(input.corrected);
+    }
+}
+BENCHMARK(BM_process_dead_zone)->Arg(0)->Arg(1);
+
+// Cursor jitter filter with the default parameters, fed a ramp at the speed
+// given as argument in hundredths of the full stick range per second and
+// sampled at the default pointer rate, as the pipeline does. Next
+// to the cost per sample, reports in lag_ms how far the filtered value
+// trails the ramp once the filter settled, which is the latency it adds.
+void BM_one_euro(benchmark::State& state)
+{
+    const float dt = 1.0f / pipeline::pointer_update_hz;
+    const float speed = state.range(0) / 100.0f;
+
+    filter::one_euro settle;
+    float x = 0.0f;
+    float y = 0.0f;
+    for (unsigned i = 0; i < 2 * pipeline::pointer_update_hz; ++i)
+    {
+        x += speed * dt;
+        y = settle.filter(x, dt);
+    }
+    state.counters["lag_ms"] = speed > 0.0f ? (x - y) / speed * 1000.0f : 0.0f;
+
+    filter::one_euro one_euro;
+    x = 0.0f;
+    for (auto _ : state)
+    {
+        x += speed * dt;
+        benchmark::DoNotOptimize(one_euro.filter(x, dt));
+    }
+}
+BENCHMARK(BM_one_euro)
+    ->Arg(0)->Arg(5)->Arg(20)->Arg(50)->Arg(100)->Arg(200)->Arg(500);
+
+// A tick with nothing deflected, only the left stick (cursor), only the
+// right stick (scroll) or only the triggers (volume) active. Every iteration
+// is a wakeup at the next deadline, so with the default rates most of them
+// only update the pointer.
+enum class tick_input
+{
+    idle,
+    cursor,
+    scroll,
+    volume
+};
+
+void BM_tick(benchmark::State& state)
+{
+    output::null_sink out;
+    clock_type::time_point now;
+    pipeline::translator translator(out, now);
+
+    switch (tick_input(state.range(0)))
+    {
+        case tick_input::idle:
+            break;
+
+        case tick_input::cursor:
+            set_axis(translator, axis::left_stick_x, 24000);
+            set_axis(translator, axis::left_stick_y, -18000);
+            break;
+
+        case tick_input::scroll:
+            set_axis(translator, axis::right_stick_y, 30000);
+            break;
+
+        case tick_input::volume:
+            set_axis(translator, axis::left_trigger, 20000);
+            set_axis(translator, axis::right_trigger, 28000);
+            break;
+    }
+
+    for (auto _ : state)
+    {
+        now = translator.next_deadline();
+        translator.tick(now);
+    }
+}
+BENCHMARK(BM_tick)
+    ->Arg(int(tick_input::idle))
+    ->Arg(int(tick_input::cursor))
+    ->Arg(int(tick_input::scroll))
+    ->Arg(int(tick_input::volume));
+
+void BM_axis_event(benchmark::State& state)
+{
+    output::null_sink out;
+    pipeline::translator translator(out, clock_type::time_point());
+
+    int value = 0;
+    for (auto _ : state)
+    {
+        value = (value + 997) & 0x7fff;
+        set_axis(translator, axis::left_stick_x, value);
+    }
+}
+BENCHMARK(BM_axis_event);
+
+// Presses and releases the button given as argument.
+void BM_button_event(benchmark::State& state)
+{
+    output::null_sink out;
+    pipeline::translator translator(out, clock_type::time_point());
+
+    auto number = int(state.range(0));
+    int value = 0;
+    for (auto _ : state)
+    {
+        value ^= 1;
+        js_event ev = make_event(JS_EVENT_BUTTON, number, value);
+        translator.handle_event(ev);
+    }
+}
+BENCHMARK(BM_button_event)
+    ->Arg(int(button::face_a))
+    ->Arg(int(button::face_y))
+    ->Arg(int(button::right_stick));
+
+} // namespace
+
+BENCHMARK_MAIN();
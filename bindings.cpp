@@ -0,0 +1,358 @@
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/XF86keysym.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+
+#include <fstream>
+#include <stdexcept>
+#include <iostream>
+
+#include "bindings.hpp"
+
+namespace bindings {
+
+namespace {
+
+using xbox360_controller::button;
+
+constexpr action no_action = { action_type::none, 0, 0 };
+
+constexpr action pointer_button(unsigned number)
+{
+    return { action_type::pointer_button, number, 0 };
+}
+
+constexpr action key(unsigned keysym, unsigned state = 0)
+{
+    return { action_type::key, keysym, state };
+}
+
+table make_default_table()
+{
+    table buttons;
+    buttons.fill(no_action);
+
+    buttons[int(button::face_a)] = pointer_button(Button1);
+    buttons[int(button::face_b)] = pointer_button(Button3);
+    buttons[int(button::face_x)] = pointer_button(Button2);
+    buttons[int(button::face_y)] = key(XK_W, ControlMask);
+    buttons[int(button::left_bumper)] = key(XF86XK_Back);
+    buttons[int(button::right_bumper)] = key(XF86XK_Forward);
+    buttons[int(button::guide)] = key(XF86XK_AudioMute);
+    buttons[int(button::back)] = key(XK_Return);
+    buttons[int(button::start)] = key(XK_space);
+
+    return buttons;
+}
+
+// Media players get no tab closing, and the bumpers skip tracks.
+profile make_media_profile()
+{
+    profile media;
+    media.name = "media";
+    media.window_classes = { "mpv", "vlc", "totem", "celluloid", "smplayer" };
+    media.buttons = default_table();
+    media.buttons[int(button::face_y)] = no_action;
+    media.buttons[int(button::left_bumper)] = key(XF86XK_AudioPrev);
+    media.buttons[int(button::right_bumper)] = key(XF86XK_AudioNext);
+    return media;
+}
+
+std::vector<profile> builtin_profiles()
+{
+    profile fallback;
+    fallback.name = "default";
+    fallback.buttons = default_table();
+
+    return { fallback, make_media_profile() };
+}
+
+bool parse_button(const std::string& name, button& result)
+{
+    static const char* const names[xbox360_controller::button_count] = {
+        "face_a", "face_b", "face_x", "face_y", "left_bumper",
+        "right_bumper", "back", "start", "guide", "left_stick", "right_stick"
+    };
+
+    for (std::size_t i = 0; i < xbox360_controller::button_count; ++i)
+    {
+        if (name == names[i])
+        {
+            result = static_cast<button>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parses "none", "button N", "key [MODIFIER+]...KEYSYM",
+// "monitor next|previous", "region N" or "absolute".
+bool parse_action(const std::string& text, action& result)
+{
+    std::vector<std::string> words;
+    boost::split(words, text, boost::is_space(), boost::token_compress_on);
+
+    if (words.size() == 1 && words[0] == "none")
+    {
+        result = no_action;
+        return true;
+    }
+
+    if (words.size() == 1 && words[0] == "absolute")
+    {
+        result = { action_type::absolute_pointer, 0, 0 };
+        return true;
+    }
+
+    if (words.size() != 2)
+    {
+        return false;
+    }
+
+    if (words[0] == "monitor")
+    {
+        if (words[1] == "next")
+        {
+            result = { action_type::monitor_jump, next_monitor, 0 };
+            return true;
+        }
+        if (words[1] == "previous")
+        {
+            result = { action_type::monitor_jump, previous_monitor, 0 };
+            return true;
+        }
+        return false;
+    }
+
+    if (words[0] == "region")
+    {
+        if (words[1].size() != 1 || words[1][0] < '1' || words[1][0] > '9')
+        {
+            return false;
+        }
+        result = { action_type::region_jump, unsigned(words[1][0] - '0'), 0 };
+        return true;
+    }
+
+    if (words[0] == "button")
+    {
+        try
+        {
+            int number = std::stoi(words[1]);
+            if (number < 1 || number > 255)
+            {
+                return false;
+            }
+            result = pointer_button(number);
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    if (words[0] != "key")
+    {
+        return false;
+    }
+
+    std::vector<std::string> parts;
+    boost::split(parts, words[1], boost::is_any_of("+"));
+
+    unsigned state = 0;
+    for (std::size_t i = 0; i + 1 < parts.size(); ++i)
+    {
+        auto modifier = boost::to_lower_copy(parts[i]);
+        if (modifier == "ctrl" || modifier == "control")
+        {
+            state |= ControlMask;
+        }
+        else if (modifier == "shift")
+        {
+            state |= ShiftMask;
+        }
+        else if (modifier == "alt")
+        {
+            state |= Mod1Mask;
+        }
+        else if (modifier == "super")
+        {
+            state |= Mod4Mask;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    KeySym keysym = XStringToKeysym(parts.back().c_str());
+    if (keysym == NoSymbol)
+    {
+        return false;
+    }
+
+    result = key(keysym, state);
+    return true;
+}
+
+} // namespace
+
+const table& default_table()
+{
+    static const table buttons = make_default_table();
+    return buttons;
+}
+
+profile_set::profile_set()
+    : entries(builtin_profiles())
+{
+}
+
+// The file consists of sections, one per profile:
+//
+//     [media]
+//     class = mpv vlc
+//     face_y = none
+//     left_bumper = key XF86AudioPrev
+//     back = key ctrl+Return
+//     face_x = button 2
+//
+// A section named like a built-in profile modifies it, any other name starts
+// from the default bindings. Lines starting with # are comments.
+bool profile_set::load(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        entries = builtin_profiles();
+        return true;
+    }
+
+    auto loaded = builtin_profiles();
+    profile* current = nullptr;
+
+    auto error = [&](int line, const std::string& message)
+    {
+        std::cerr << boost::str(boost::format("%1%:%2%: %3%\n")
+                % path % line % message);
+        return false;
+    };
+
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); ++line_number)
+    {
+        boost::trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        if (line.front() == '[' && line.back() == ']')
+        {
+            auto name = boost::trim_copy(line.substr(1, line.size() - 2));
+            if (name.empty())
+            {
+                return error(line_number, "empty profile name");
+            }
+
+            current = nullptr;
+            for (auto& entry : loaded)
+            {
+                if (entry.name == name)
+                {
+                    current = &entry;
+                }
+            }
+
+            if (!current)
+            {
+                profile added;
+                added.name = name;
+                added.buttons = default_table();
+                loaded.push_back(added);
+                current = &loaded.back();
+            }
+            continue;
+        }
+
+        auto equals = line.find('=');
+        if (equals == std::string::npos)
+        {
+            return error(line_number, "expected 'name = value'");
+        }
+        if (!current)
+        {
+            return error(line_number, "binding outside of a profile");
+        }
+
+        auto name = boost::trim_copy(line.substr(0, equals));
+        auto value = boost::trim_copy(line.substr(equals + 1));
+
+        button bound_button;
+        if (name == "class")
+        {
+            if (current == &loaded.front())
+            {
+                return error(line_number,
+                             "the default profile cannot match classes");
+            }
+
+            current->window_classes.clear();
+            boost::split(current->window_classes, value, boost::is_space(),
+                         boost::token_compress_on);
+        }
+        else if (parse_button(name, bound_button))
+        {
+            if (bound_button == button::left_stick ||
+                bound_button == button::right_stick)
+            {
+                return error(line_number, "stick buttons cannot be bound");
+            }
+            if (!parse_action(value, current->buttons[int(bound_button)]))
+            {
+                return error(line_number, "invalid action '" + value + "'");
+            }
+        }
+        else
+        {
+            return error(line_number, "unknown button '" + name + "'");
+        }
+    }
+
+    entries = std::move(loaded);
+    return true;
+}
+
+const profile& profile_set::select(const std::string& res_name,
+                                   const std::string& res_class) const
+{
+    for (const auto& entry : entries)
+    {
+        for (const auto& window_class : entry.window_classes)
+        {
+            if (boost::iequals(window_class, res_name) ||
+                boost::iequals(window_class, res_class))
+            {
+                return entry;
+            }
+        }
+    }
+    return entries.front();
+}
+
+const profile* profile_set::find(const std::string& name) const
+{
+    for (const auto& entry : entries)
+    {
+        if (entry.name == name)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace bindings
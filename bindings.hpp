@@ -0,0 +1,95 @@
+#ifndef JOY2MOUSE_BINDINGS_HPP
+#define JOY2MOUSE_BINDINGS_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "xbox360_controller.hpp"
+
+namespace bindings {
+
+enum class action_type
+{
+    none,
+    pointer_button,
+    key,
+
+    // Moves the pointer to the center of the next or previous monitor.
+    monitor_jump,
+
+    // Moves the pointer to the center of a region of its monitor.
+    region_jump,
+
+    // While held, the right stick positions the pointer inside the monitor
+    // it was on instead of scrolling.
+    absolute_pointer
+};
+
+// Codes of monitor_jump actions.
+constexpr unsigned next_monitor = 0;
+constexpr unsigned previous_monitor = 1;
+
+struct action
+{
+    action_type type;
+
+    // Pointer button number, keysym, monitor_jump direction or region_jump
+    // region, 1 to 9 in a 3x3 grid from the top left.
+    unsigned code;
+
+    // Modifier mask sent along with a key.
+    unsigned state;
+};
+
+// What every controller button does, indexed by xbox360_controller::button.
+// The stick buttons are not looked up here, they always act as modifiers.
+using table = std::array<action, xbox360_controller::button_count>;
+
+struct profile
+{
+    std::string name = {};
+
+    // WM_CLASS names or classes the profile applies to, compared without
+    // regard to case.
+    std::vector<std::string> window_classes = {};
+
+    table buttons = {};
+};
+
+// The built-in bindings used when no profile matches.
+const table& default_table();
+
+// A set of profiles, each compiled into its own table, so switching between
+// them is a pointer swap. The first profile is always the default one.
+class profile_set
+{
+public:
+    // Starts out with the built-in profiles.
+    profile_set();
+
+    // Replaces the profiles with the built-in ones plus those in path. A
+    // missing file is not an error. Errors are reported on std::cerr and
+    // leave the set unchanged.
+    bool load(const std::string& path);
+
+    // Returns the profile for a window with the given WM_CLASS, or the
+    // default profile if none matches.
+    const profile& select(const std::string& res_name,
+                          const std::string& res_class) const;
+
+    // Returns the profile with the given name, or nullptr.
+    const profile* find(const std::string& name) const;
+
+    const std::vector<profile>& profiles() const
+    {
+        return entries;
+    }
+
+private:
+    std::vector<profile> entries;
+};
+
+} // namespace bindings
+
+#endif // !defined(JOY2MOUSE_BINDINGS_HPP)
@@ -0,0 +1,329 @@
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "calibration.hpp"
+
+namespace calibration {
+
+namespace {
+
+using xbox360_controller::dead_zones;
+
+// Samples are taken once per tick.
+constexpr std::uint64_t window_length = 30;
+constexpr std::uint64_t adaptive_memory = 60 * 600;
+constexpr std::uint64_t adaptive_update_interval = 60 * 10;
+constexpr std::uint64_t min_rest_samples = 120;
+
+// A window counts as resting if the input moved less than this (standard
+// deviation) and sat inside the dead zone around its current rest.
+constexpr double rest_jitter_limit = 600;
+
+// Dead zones cover this many standard deviations of resting noise and of
+// the spread of the positions a stick comes back to after being released.
+// Until enough releases were seen to know that spread, stick dead zones do
+// not shrink below the specification.
+constexpr double noise_factor = 4;
+constexpr std::uint64_t min_releases = 8;
+constexpr std::uint64_t adaptive_release_memory = 200;
+constexpr double stick_margin = 500;
+constexpr double min_stick_dead_zone = 2000;
+constexpr double max_stick_dead_zone = 16000;
+constexpr double trigger_margin = 30;
+constexpr double max_trigger_threshold = 8000;
+
+enum input
+{
+    left_x,
+    left_y,
+    right_x,
+    right_y,
+    left_trigger,
+    right_trigger
+};
+
+double clamp(double value, double low, double high)
+{
+    return std::min(std::max(value, low), high);
+}
+
+} // namespace
+
+running_stats::running_stats(std::uint64_t max_count)
+    : max_count(max_count), n(0), mean_value(0), m2(0)
+{
+}
+
+void running_stats::add(double x)
+{
+    if (n < max_count)
+    {
+        ++n;
+    }
+    else
+    {
+        // Forget the equivalent of one old sample.
+        m2 -= m2 / n;
+    }
+
+    double delta = x - mean_value;
+    mean_value += delta / n;
+    m2 += delta * (x - mean_value);
+}
+
+// Chan et al.'s combination of two sets of statistics.
+void running_stats::merge(const running_stats& other)
+{
+    if (!other.n)
+    {
+        return;
+    }
+
+    double total = double(n) + other.n;
+    double delta = other.mean_value - mean_value;
+    mean_value += delta * other.n / total;
+    m2 += other.m2 + delta * delta * n * other.n / total;
+
+    if (total > max_count)
+    {
+        m2 *= max_count / total;
+        n = max_count;
+    }
+    else
+    {
+        n = std::uint64_t(total);
+    }
+}
+
+void running_stats::reset()
+{
+    n = 0;
+    mean_value = 0;
+    m2 = 0;
+}
+
+double running_stats::variance() const
+{
+    return n > 1 ? m2 / (n - 1) : 0.0;
+}
+
+estimator::estimator(mode sample_mode, const dead_zones& initial)
+    : sample_mode(sample_mode), current(initial), window(), rest(),
+      release(), was_resting(), samples_since_update(0)
+{
+    if (sample_mode == mode::adaptive)
+    {
+        for (auto& stats : rest)
+        {
+            stats = running_stats(adaptive_memory);
+        }
+        for (auto& stats : release)
+        {
+            stats = running_stats(adaptive_release_memory);
+        }
+    }
+}
+
+bool estimator::add_sample(const xbox360_controller::analog_state& raw)
+{
+    const double values[input_count] = {
+        raw.left_stick[0], raw.left_stick[1],
+        raw.right_stick[0], raw.right_stick[1],
+        raw.left_trigger, raw.right_trigger
+    };
+
+    if (sample_mode == mode::one_shot)
+    {
+        for (int i = 0; i < input_count; ++i)
+        {
+            rest[i].add(values[i]);
+        }
+        update_result();
+        return true;
+    }
+
+    for (int i = 0; i < input_count; ++i)
+    {
+        window[i].add(values[i]);
+    }
+    if (window[0].count() < window_length)
+    {
+        return false;
+    }
+
+    const double rests[input_count] = {
+        current.left_stick_center[0], current.left_stick_center[1],
+        current.right_stick_center[0], current.right_stick_center[1],
+        current.left_trigger_rest, current.right_trigger_rest
+    };
+    const double zones[input_count] = {
+        current.left_stick, current.left_stick,
+        current.right_stick, current.right_stick,
+        current.left_trigger_threshold, current.right_trigger_threshold
+    };
+
+    // A stick held still while deflected is not resting, so windows have
+    // to lie inside the dead zone around the rest learned so far. Triggers
+    // may rest at either end of their axis; the first quiet window tells
+    // which.
+    bool resting[input_count];
+    for (int i = 0; i < input_count; ++i)
+    {
+        double learned = rest[i].count() ? rest[i].mean() : rests[i];
+        bool seeding = i >= left_trigger && !rest[i].count();
+        resting[i] = std::sqrt(window[i].variance()) < rest_jitter_limit
+            && (seeding || std::abs(window[i].mean() - learned) < zones[i]);
+    }
+
+    // Both axes of a stick have to be at rest.
+    resting[left_x] = resting[left_y] = resting[left_x] && resting[left_y];
+    resting[right_x] = resting[right_y] = resting[right_x] && resting[right_y];
+
+    for (int i = 0; i < input_count; ++i)
+    {
+        if (resting[i])
+        {
+            // The first resting window after a movement is where the input
+            // came back to.
+            if (!was_resting[i])
+            {
+                release[i].add(window[i].mean());
+            }
+            rest[i].merge(window[i]);
+        }
+        was_resting[i] = resting[i];
+        window[i].reset();
+    }
+
+    samples_since_update += window_length;
+    if (samples_since_update < adaptive_update_interval || !settled())
+    {
+        return false;
+    }
+
+    samples_since_update = 0;
+    update_result();
+    return true;
+}
+
+bool estimator::settled() const
+{
+    return std::all_of(std::begin(rest), std::end(rest),
+                       [](const running_stats& stats)
+                       {
+                           return stats.count() >= min_rest_samples;
+                       });
+}
+
+void estimator::update_result()
+{
+    const dead_zones spec;
+    auto stick_dead_zone = [this](int x, int y, double spec_zone)
+    {
+        double noise = std::sqrt(rest[x].variance() + rest[y].variance());
+        if (release[x].count() < min_releases)
+        {
+            return clamp(noise_factor * noise + stick_margin, spec_zone,
+                         max_stick_dead_zone);
+        }
+
+        double spread = std::sqrt(release[x].variance()
+                                  + release[y].variance());
+        return clamp(noise_factor * (noise + spread) + stick_margin,
+                     min_stick_dead_zone, max_stick_dead_zone);
+    };
+    auto trigger_threshold = [this](int i)
+    {
+        double noise = std::sqrt(rest[i].variance());
+        return clamp(noise_factor * noise + trigger_margin, trigger_margin,
+                     max_trigger_threshold);
+    };
+
+    current.left_stick_center = { float(rest[left_x].mean()),
+                                  float(rest[left_y].mean()) };
+    current.right_stick_center = { float(rest[right_x].mean()),
+                                   float(rest[right_y].mean()) };
+    current.left_stick = stick_dead_zone(left_x, left_y, spec.left_stick);
+    current.right_stick = stick_dead_zone(right_x, right_y,
+                                          spec.right_stick);
+
+    current.left_trigger_rest = rest[left_trigger].mean();
+    current.right_trigger_rest = rest[right_trigger].mean();
+    current.left_trigger_threshold = trigger_threshold(left_trigger);
+    current.right_trigger_threshold = trigger_threshold(right_trigger);
+}
+
+std::string device_key(const std::string& guid, const std::string& name)
+{
+    std::string key = guid.empty() ? name : guid;
+    std::replace_if(key.begin(), key.end(),
+                    [](char c) { return std::isspace(c); }, '_');
+    return key;
+}
+
+// One line per device: the key followed by the fields of dead_zones in
+// declaration order.
+bool load(const std::string& path, const std::string& key, dead_zones& result)
+{
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::istringstream fields(line);
+        std::string line_key;
+        dead_zones zones;
+        if (fields >> line_key && line_key == key &&
+            fields >> zones.left_stick_center[0] >> zones.left_stick_center[1]
+                   >> zones.right_stick_center[0]
+                   >> zones.right_stick_center[1]
+                   >> zones.left_stick >> zones.right_stick
+                   >> zones.left_trigger_rest >> zones.right_trigger_rest
+                   >> zones.left_trigger_threshold
+                   >> zones.right_trigger_threshold)
+        {
+            result = zones;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool save(const std::string& path, const std::string& key,
+          const dead_zones& zones)
+{
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (!boost::starts_with(line, key + " "))
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    lines.push_back(boost::str(boost::format(
+        "%1% %2% %3% %4% %5% %6% %7% %8% %9% %10% %11%")
+        % key % zones.left_stick_center[0] % zones.left_stick_center[1]
+        % zones.right_stick_center[0] % zones.right_stick_center[1]
+        % zones.left_stick % zones.right_stick
+        % zones.left_trigger_rest % zones.right_trigger_rest
+        % zones.left_trigger_threshold % zones.right_trigger_threshold));
+
+    std::ofstream out(path);
+    for (const auto& line : lines)
+    {
+        out << line << '\n';
+    }
+    return bool(out.flush());
+}
+
+} // namespace calibration
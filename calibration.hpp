@@ -0,0 +1,102 @@
+#ifndef JOY2MOUSE_CALIBRATION_HPP
+#define JOY2MOUSE_CALIBRATION_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "xbox360_controller.hpp"
+
+namespace calibration {
+
+// Streaming mean and variance (Welford). With a sample limit, the count
+// stops growing once it is reached, so old samples are gradually forgotten
+// and the statistics follow slow changes.
+class running_stats
+{
+public:
+    explicit running_stats(std::uint64_t max_count = UINT64_MAX);
+
+    void add(double x);
+    void merge(const running_stats& other);
+    void reset();
+
+    std::uint64_t count() const
+    {
+        return n;
+    }
+
+    double mean() const
+    {
+        return mean_value;
+    }
+
+    double variance() const;
+
+private:
+    std::uint64_t max_count;
+    std::uint64_t n;
+    double mean_value;
+    double m2;
+};
+
+enum class mode
+{
+    // Every sample is taken to be at rest.
+    one_shot,
+
+    // Only samples from windows in which an input barely moved count, and
+    // old samples are forgotten.
+    adaptive
+};
+
+// Derives resting positions and dead zones from raw analog samples.
+class estimator
+{
+public:
+    estimator(mode sample_mode, const xbox360_controller::dead_zones& initial);
+
+    // Feeds the raw state of one tick. Returns true when result() changed.
+    bool add_sample(const xbox360_controller::analog_state& raw);
+
+    const xbox360_controller::dead_zones& result() const
+    {
+        return current;
+    }
+
+    // Enough samples for a result; adaptive estimates are only published
+    // then.
+    bool settled() const;
+
+private:
+    static constexpr int input_count = 6;
+
+    void update_result();
+
+    mode sample_mode;
+    xbox360_controller::dead_zones current;
+
+    // Left stick x and y, right stick x and y, left and right trigger.
+    running_stats window[input_count];
+    running_stats rest[input_count];
+
+    // Positions returned to after each release, and whether the previous
+    // window was resting.
+    running_stats release[input_count];
+    bool was_resting[input_count];
+    std::uint64_t samples_since_update;
+};
+
+// Calibrations are stored per device, keyed by GUID or, lacking one, name.
+std::string device_key(const std::string& guid, const std::string& name);
+
+// Reads the calibration for a device. Returns false if there is none.
+bool load(const std::string& path, const std::string& key,
+          xbox360_controller::dead_zones& result);
+
+// Stores the calibration for a device, keeping those of other devices.
+bool save(const std::string& path, const std::string& key,
+          const xbox360_controller::dead_zones& zones);
+
+} // namespace calibration
+
+#endif // !defined(JOY2MOUSE_CALIBRATION_HPP)
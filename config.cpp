@@ -0,0 +1,43 @@
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <cstdlib>
+
+#include "config.hpp"
+
+namespace config {
+
+bool create_directory()
+{
+    std::string directory = path("");
+    for (auto slash = directory.find('/', 1); slash != std::string::npos;
+         slash = directory.find('/', slash + 1))
+    {
+        if (mkdir(directory.substr(0, slash).c_str(), 0755) < 0 &&
+            errno != EEXIST)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string path(const std::string& name)
+{
+    std::string directory;
+    if (const char* config_home = std::getenv("XDG_CONFIG_HOME"))
+    {
+        directory = config_home;
+    }
+    else if (const char* home = std::getenv("HOME"))
+    {
+        directory = std::string(home) + "/.config";
+    }
+    else
+    {
+        directory = ".";
+    }
+    return directory + "/joy2mouse/" + name;
+}
+
+} // namespace config
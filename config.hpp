@@ -0,0 +1,17 @@
+#ifndef JOY2MOUSE_CONFIG_HPP
+#define JOY2MOUSE_CONFIG_HPP
+
+#include <string>
+
+namespace config {
+
+// Returns the path of a file in the joy2mouse configuration directory,
+// $XDG_CONFIG_HOME/joy2mouse or ~/.config/joy2mouse.
+std::string path(const std::string& name);
+
+// Creates the configuration directory if it does not exist yet.
+bool create_directory();
+
+} // namespace config
+
+#endif // !defined(JOY2MOUSE_CONFIG_HPP)
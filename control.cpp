@@ -0,0 +1,198 @@
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "control.hpp"
+
+namespace control {
+
+namespace {
+
+// Commands are short; anything longer is not a client of ours.
+constexpr std::size_t max_command_length = 256;
+
+// Connections waiting for their command. Beyond this, the oldest is
+// dropped, so clients that never finish a line cannot pile up.
+constexpr std::size_t max_clients = 8;
+
+// Whether path is a socket nobody listens on any more. Anything else at
+// path is left alone.
+bool stale_socket(const std::string& path, const sockaddr_un& address)
+{
+    struct stat status;
+    if (lstat(path.c_str(), &status) < 0)
+    {
+        return false;
+    }
+    if (!S_ISSOCK(status.st_mode))
+    {
+        errno = EEXIST;
+        return false;
+    }
+
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0)
+    {
+        return false;
+    }
+    bool listening = connect(probe, reinterpret_cast<const sockaddr*>(&address),
+                             sizeof(address)) == 0;
+    close(probe);
+    if (listening)
+    {
+        errno = EADDRINUSE;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::string default_path()
+{
+    if (const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR"))
+    {
+        return std::string(runtime_dir) + "/joy2mouse.sock";
+    }
+    return "/tmp/joy2mouse-" + std::to_string(getuid()) + ".sock";
+}
+
+server::server(handler handle_command)
+    : handle_command(std::move(handle_command)), path(), listen_fd(-1),
+      clients()
+{
+}
+
+server::~server()
+{
+    while (!clients.empty())
+    {
+        drop(clients.begin());
+    }
+
+    if (listen_fd >= 0)
+    {
+        close(listen_fd);
+        unlink(path.c_str());
+    }
+}
+
+bool server::open(const std::string& path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    if (stale_socket(path, address))
+    {
+        unlink(path.c_str());
+    }
+    else if (errno == EEXIST || errno == EADDRINUSE)
+    {
+        return false;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+    {
+        return false;
+    }
+
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address),
+             sizeof(address)) < 0 ||
+        listen(listen_fd, 4) < 0)
+    {
+        int error = errno;
+        close(listen_fd);
+        listen_fd = -1;
+        errno = error;
+        return false;
+    }
+
+    this->path = path;
+    return true;
+}
+
+bool server::owns(int fd) const
+{
+    return std::any_of(clients.begin(), clients.end(),
+                       [fd](const client& c) { return c.fd == fd; });
+}
+
+int server::accept()
+{
+    int fd = accept4(listen_fd, nullptr, nullptr,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0)
+    {
+        if (clients.size() >= max_clients)
+        {
+            drop(clients.begin());
+        }
+        clients.push_back({ fd, std::string() });
+    }
+    return fd;
+}
+
+bool server::service(int fd)
+{
+    auto it = std::find_if(clients.begin(), clients.end(),
+                           [fd](const client& c) { return c.fd == fd; });
+    if (it == clients.end())
+    {
+        return false;
+    }
+
+    char buffer[max_command_length];
+    ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+    if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        return false;
+    }
+    if (bytes_read <= 0)
+    {
+        drop(it);
+        return true;
+    }
+
+    it->input.append(buffer, bytes_read);
+
+    auto newline = it->input.find('\n');
+    if (newline == std::string::npos)
+    {
+        if (it->input.size() >= max_command_length)
+        {
+            drop(it);
+            return true;
+        }
+        return false;
+    }
+
+    auto reply = handle_command(it->input.substr(0, newline));
+
+    // The reply is small enough for the socket buffer, a client that does
+    // not read it just loses it.
+    send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+
+    drop(it);
+    return true;
+}
+
+void server::drop(std::vector<client>::iterator it)
+{
+    close(it->fd);
+    clients.erase(it);
+}
+
+} // namespace control
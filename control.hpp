@@ -0,0 +1,67 @@
+#ifndef JOY2MOUSE_CONTROL_HPP
+#define JOY2MOUSE_CONTROL_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace control {
+
+// Default socket path, in $XDG_RUNTIME_DIR if set.
+std::string default_path();
+
+// A Unix domain stream socket accepting one-line commands.
+//
+// Clients connect, send a single command terminated by a newline and get
+// the reply before the connection is closed. All file descriptors are
+// non-blocking and meant to be registered in the caller's epoll set.
+class server
+{
+public:
+    using handler = std::function<std::string (const std::string& command)>;
+
+    explicit server(handler handle_command);
+    ~server();
+
+    server(const server&) = delete;
+    server& operator= (const server&) = delete;
+
+    // Binds and listens on path, replacing a socket nobody listens on.
+    // Fails with EEXIST if something else is at path, and with EADDRINUSE
+    // if another server listens there. Returns false with errno set on
+    // failure.
+    bool open(const std::string& path);
+
+    int fd() const
+    {
+        return listen_fd;
+    }
+
+    bool owns(int fd) const;
+
+    // Accepts a pending connection and returns its descriptor, or -1. With
+    // too many clients waiting, the oldest one is dropped.
+    int accept();
+
+    // Reads from a client, replying and returning true once it is done, in
+    // which case the descriptor has been closed.
+    bool service(int fd);
+
+private:
+    struct client
+    {
+        int fd;
+        std::string input;
+    };
+
+    void drop(std::vector<client>::iterator it);
+
+    handler handle_command;
+    std::string path;
+    int listen_fd;
+    std::vector<client> clients;
+};
+
+} // namespace control
+
+#endif // !defined(JOY2MOUSE_CONTROL_HPP)
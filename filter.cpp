@@ -0,0 +1,51 @@
+#include "filter.hpp"
+
+#include <cmath>
+
+namespace filter {
+
+namespace {
+
+const float pi = 3.14159265358979f;
+
+// Smoothing factor of an exponential smoother with the given cutoff.
+float alpha(float cutoff, float dt)
+{
+    float tau = 1.0f / (2.0f * pi * cutoff);
+    return 1.0f / (1.0f + tau / dt);
+}
+
+} // namespace
+
+one_euro::one_euro(const one_euro_parameters& parameters)
+    : params(parameters), primed(false), previous(0.0f),
+      previous_derivative(0.0f)
+{
+}
+
+float one_euro::filter(float x, float dt)
+{
+    if (!primed)
+    {
+        primed = true;
+        previous = x;
+        previous_derivative = 0.0f;
+        return x;
+    }
+
+    float derivative = (x - previous) / dt;
+    float a_d = alpha(params.derivative_cutoff, dt);
+    previous_derivative += a_d * (derivative - previous_derivative);
+
+    float cutoff =
+        params.min_cutoff + params.beta * std::abs(previous_derivative);
+    previous += alpha(cutoff, dt) * (x - previous);
+    return previous;
+}
+
+void one_euro::reset()
+{
+    primed = false;
+}
+
+} // namespace filter
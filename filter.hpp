@@ -0,0 +1,51 @@
+#ifndef JOY2MOUSE_FILTER_HPP
+#define JOY2MOUSE_FILTER_HPP
+
+namespace filter {
+
+// Tuning of a one_euro filter. Cutoffs are in Hz, beta in Hz per unit/s of
+// input speed.
+struct one_euro_parameters
+{
+    // Cutoff at rest; lower removes more jitter from a still input.
+    float min_cutoff = 1.0f;
+
+    // How fast the cutoff rises with speed; higher lags less when moving.
+    float beta = 5.0f;
+
+    // Cutoff of the speed estimate itself.
+    float derivative_cutoff = 1.0f;
+};
+
+// Speed-adaptive low-pass filter (Casiez et al., "1 Euro Filter", CHI 2012).
+//
+// An exponential smoother whose cutoff grows with the smoothed speed of
+// the input, so an input held still is filtered heavily while fast motion
+// passes through almost unchanged.
+class one_euro
+{
+public:
+    explicit one_euro(const one_euro_parameters& parameters =
+                          one_euro_parameters());
+
+    // Filters the next sample, dt seconds after the previous one.
+    float filter(float x, float dt);
+
+    // Forgets the history; the next sample passes through unchanged.
+    void reset();
+
+    const one_euro_parameters& parameters() const
+    {
+        return params;
+    }
+
+private:
+    one_euro_parameters params;
+    bool primed;
+    float previous;
+    float previous_derivative;
+};
+
+} // namespace filter
+
+#endif // !defined(JOY2MOUSE_FILTER_HPP)
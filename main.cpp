@@ -6,280 +6,386 @@
 #include <linux/joystick.h>
 #include <sys/epoll.h>
 #include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <poll.h>
+#include <signal.h>
 #include <X11/Xlib.h>
-#include <X11/keysym.h>
-#include <X11/XF86keysym.h>
 
 #include <boost/format.hpp>
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <string>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <chrono>
-
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "active_window.hpp"
+#include "bindings.hpp"
+#include "calibration.hpp"
+#include "config.hpp"
+#include "control.hpp"
+#include "filter.hpp"
+#include "mapping.hpp"
+#include "monitors.hpp"
+#include "output.hpp"
+#include "pipeline.hpp"
+#include "recording.hpp"
+#include "scheduler.hpp"
+#include "seats.hpp"
+#include "state_export.hpp"
+#include "trace.hpp"
+#include "uinput_output.hpp"
+#include "x11_output.hpp"
 #include "xbox360_controller.hpp"
-#include "vec.hpp"
 
 const char* joystick_interface = "/dev/input/js0";
+const char* trace_output = "joy2mouse-trace.json";
+const unsigned max_rate_hz = 4000;
 
-constexpr unsigned cursor_update_hz = 60;
-
-constexpr float cursor_speed = 15;
-constexpr float cursor_gamma = 2.5f;
-constexpr float cursor_accel_threshold = 0.25f;
-constexpr float cursor_reset_threshold = 0.2f;
-constexpr float max_cursor_accel = 2.5f;
-constexpr float cursor_accel_time = 2.0f;
-constexpr float cursor_accel_factor =
-    cursor_accel_time * (max_cursor_accel - 1.0f) / cursor_update_hz;
-
-constexpr float scroll_speed = 7;
-constexpr float scroll_gamma = 3.0f;
-constexpr float scroll_accel_threshold = 0.25f;
-constexpr float scroll_reset_threshold = 0.2f;
-constexpr float max_scroll_accel = 4.0f;
-constexpr float scroll_accel_time = 2.0f;
-constexpr float scroll_accel_factor =
-    scroll_accel_time * (max_scroll_accel - 1.0f) / cursor_update_hz;
-
-constexpr float volume_up_speed = 7;
-constexpr float volume_up_gamma = 3.0f;
-constexpr float volume_up_accel_threshold = 0.25f;
-constexpr float volume_up_reset_threshold = 0.2f;
-constexpr float max_volume_up_accel = 4.0f;
-constexpr float volume_up_accel_time = 2.0f;
-constexpr float volume_up_accel_factor =
-    volume_up_accel_time * (max_volume_up_accel - 1.0f) / cursor_update_hz;
-
-constexpr float volume_down_speed = 7;
-constexpr float volume_down_gamma = 3.0f;
-constexpr float volume_down_accel_threshold = 0.25f;
-constexpr float volume_down_reset_threshold = 0.2f;
-constexpr float max_volume_down_accel = 4.0f;
-constexpr float volume_down_accel_time = 2.0f;
-constexpr float volume_down_accel_factor =
-    volume_down_accel_time * (max_volume_down_accel - 1.0f) / cursor_update_hz;
-
-void send_button_event(Display* dpy, unsigned button, bool release)
-{
-    XEvent event = {};
+using pipeline::clock_type;
 
-    event.type = ButtonPress;
-    event.xbutton.button = button;
-    event.xbutton.same_screen = True;
-    event.xbutton.subwindow = RootWindow(dpy, DefaultScreen(dpy));
+struct options
+{
+    std::string profiles_path = config::path("profiles");
+    bool profiles_given = false;
+    std::string control_path = control::default_path();
+    std::string mapping_db_path = config::path("gamecontrollerdb.txt");
+    std::string calibration_path = config::path("calibration");
+    const char* record_path = nullptr;
+    const char* replay_path = nullptr;
+    const char* seats_path = nullptr;
+    bool realtime = false;
+    bool x11 = false;
+    bool smooth_scroll = false;
+    bool filter_cursor = false;
+    std::array<filter::one_euro_parameters, 2> cursor_filter = {};
+    bool cursor_filter_given = false;
+    std::array<unsigned, pipeline::output_channel_count> rates_hz =
+        pipeline::settings().rates_hz;
+    bool rates_given = false;
+    bool calibrate = false;
+    bool adaptive_calibration = false;
+};
+
+void print_usage(const char* program)
+{
+    std::cerr << boost::str(boost::format(
+        "usage: %1% [--profiles FILE] [--mapping-db FILE] [--control SOCKET]\n"
+        "          [--record FILE] [--smooth-scroll] [--adaptive-calibration]\n"
+        "          [--cursor-filter SPEC] [--rates P,S,V,R]\n"
+        "       %1% --seats FILE [--profiles FILE] [--mapping-db FILE]\n"
+        "          [--cursor-filter SPEC] [--rates P,S,V,R]\n"
+        "       %1% --calibrate [--mapping-db FILE]\n"
+        "       %1% --replay FILE [--realtime] [--x11]\n"
+        "\n"
+        "  --profiles FILE  per-application button bindings (default\n"
+        "                   %2%)\n"
+        "  --mapping-db FILE\n"
+        "                   SDL gamecontrollerdb with controller layouts\n"
+        "                   (default %3%)\n"
+        "  --control SOCKET accept control commands on SOCKET (default\n"
+        "                   %4%)\n"
+        "  --record FILE    log every raw joystick event to FILE\n"
+        "  --seats FILE     serve every controller and display or uinput\n"
+        "                   device pair in the seat table FILE\n"
+        "  --calibrate      measure the resting noise of the controller and\n"
+        "                   store its dead zones in %5%\n"
+        "  --adaptive-calibration\n"
+        "                   keep adjusting the dead zones to resting noise\n"
+        "                   while running\n"
+        "  --smooth-scroll  scroll by fractional notches through a uinput\n"
+        "                   high-resolution wheel instead of button clicks\n"
+        "  --cursor-filter SPEC\n"
+        "                   jitter filter of the cursor stick: \"off\"\n"
+        "                   (default), \"on\" for %6%,%7%, or\n"
+        "                   MIN_CUTOFF,BETA for both axes, or\n"
+        "                   MIN_CUTOFF,BETA:MIN_CUTOFF,BETA for x and y\n"
+        "  --rates P,S,V,R  updates per second of the pointer, scrolling,\n"
+        "                   volume and d-pad keys (default %8%,%9%,%9%,%9%)\n"
+        "  --replay FILE    feed a recording through the pipeline on a\n"
+        "                   simulated clock and print the resulting actions\n"
+        "  --realtime       replay at the recorded pace instead of as fast\n"
+        "                   as possible\n"
+        "  --x11            send replayed actions to the X display\n")
+        % program % config::path("profiles")
+        % config::path("gamecontrollerdb.txt") % control::default_path()
+        % config::path("calibration")
+        % filter::one_euro_parameters().min_cutoff
+        % filter::one_euro_parameters().beta
+        % pipeline::pointer_update_hz % pipeline::update_hz);
+}
 
-    if (release)
+// Parses the --cursor-filter argument.
+bool parse_cursor_filter(const char* spec, options& opts)
+{
+    if (std::strcmp(spec, "off") == 0)
     {
-        event.type = ButtonRelease;
-        event.xbutton.state = 0x100;
+        opts.filter_cursor = false;
+        return true;
     }
-
-    while (event.xbutton.subwindow)
+    if (std::strcmp(spec, "on") == 0)
     {
-        event.xbutton.window = event.xbutton.subwindow;
-        XQueryPointer(dpy, event.xbutton.window, &event.xbutton.root,
-                      &event.xbutton.subwindow, &event.xbutton.x_root,
-                      &event.xbutton.y_root, &event.xbutton.x, &event.xbutton.y,
-                      &event.xbutton.state);
+        opts.filter_cursor = true;
+        opts.cursor_filter = {};
+        return true;
     }
 
-    XSendEvent(dpy, PointerWindow, True, ButtonPressMask, &event);
-    XFlush(dpy);
-}
+    auto& x = opts.cursor_filter[0];
+    auto& y = opts.cursor_filter[1];
+    int consumed = 0;
+    int fields = std::sscanf(spec, "%f,%f%n:%f,%f%n", &x.min_cutoff, &x.beta,
+                             &consumed, &y.min_cutoff, &y.beta, &consumed);
+    if ((fields != 2 && fields != 4) || spec[consumed] != '\0')
+    {
+        return false;
+    }
+    if (fields == 2)
+    {
+        y = x;
+    }
 
-void send_keyboard_event(Display* dpy, unsigned key, bool release, unsigned state = 0)
-{
-    XEvent event = {};
-
-    Window focused_window;
-    int revert;
-    XGetInputFocus(dpy, &focused_window, &revert);
-
-    event.xkey.display = dpy;
-    event.xkey.window = focused_window;
-    event.xkey.root = RootWindow(dpy, DefaultScreen(dpy));
-    event.xkey.subwindow = None;
-    event.xkey.time = CurrentTime;
-    event.xkey.x = 1;
-    event.xkey.y = 1;
-    event.xkey.x_root = 1;
-    event.xkey.y_root = 1;
-    event.xkey.same_screen = True;
-    event.xkey.keycode = XKeysymToKeycode(dpy, key);
-    event.xkey.state = state;
-
-    event.type = release ? KeyRelease : KeyPress;
-
-    XSendEvent(dpy, focused_window, True, KeyPressMask, &event);
-    XFlush(dpy);
+    opts.filter_cursor = true;
+    return x.min_cutoff > 0.0f && y.min_cutoff > 0.0f
+        && x.beta >= 0.0f && y.beta >= 0.0f;
 }
 
-void apply_axis_input(xbox360_controller::input_state& controller_state,
-                      js_event ev)
+// Parses the --rates argument.
+bool parse_rates(const char* spec, options& opts)
 {
-    using xbox360_controller::axis;
-
-    auto& uncorrected = controller_state.uncorrected;
-    auto value = ev.value;
-
-    auto updated_axis = static_cast<axis>(ev.number);
-    switch (updated_axis)
+    auto& rates = opts.rates_hz;
+    int consumed = 0;
+    int fields = std::sscanf(spec, "%u,%u,%u,%u%n", &rates[0], &rates[1],
+                             &rates[2], &rates[3], &consumed);
+    if (fields != 4 || spec[consumed] != '\0')
     {
-        case axis::left_stick_x:
-            uncorrected.left_stick[0] = value;
-            break;
-
-        case axis::left_stick_y:
-            uncorrected.left_stick[1] = value;
-            break;
-
-        case axis::left_trigger:
-            uncorrected.left_trigger = value;
-            break;
-
-        case axis::right_stick_x:
-            uncorrected.right_stick[0] = value;
-            break;
-
-        case axis::right_stick_y:
-            uncorrected.right_stick[1] = value;
-            break;
-
-        case axis::right_trigger:
-            uncorrected.right_trigger = value;
-            break;
-
-        case axis::dpad_x:
-            controller_state.dpad[0] = value / 32767.0f;
-            break;
+        return false;
+    }
 
-        case axis::dpad_y:
-            controller_state.dpad[1] = value / 32767.0f;
-            break;
+    for (auto rate_hz : rates)
+    {
+        if (rate_hz == 0 || rate_hz > max_rate_hz)
+        {
+            return false;
+        }
     }
+    return true;
 }
 
-void handle_joystick_event(xbox360_controller::input_state& controller_state,
-                           js_event ev, Display* dpy)
+bool parse_options(int argc, char** argv, options& opts)
 {
-    switch (ev.type)
+    for (int i = 1; i < argc; ++i)
     {
-        case JS_EVENT_BUTTON:
+        if (std::strcmp(argv[i], "--profiles") == 0 && i + 1 < argc)
         {
-            using xbox360_controller::button;
-
-            auto updated_button = static_cast<button>(ev.number);
-            bool pressed = ev.value ? true : false;
-
-            // Left click
-            if (updated_button == button::face_a)
+            opts.profiles_path = argv[++i];
+            opts.profiles_given = true;
+        }
+        else if (std::strcmp(argv[i], "--mapping-db") == 0 && i + 1 < argc)
+        {
+            opts.mapping_db_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--control") == 0 && i + 1 < argc)
+        {
+            opts.control_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            opts.record_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--seats") == 0 && i + 1 < argc)
+        {
+            opts.seats_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            opts.replay_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--realtime") == 0)
+        {
+            opts.realtime = true;
+        }
+        else if (std::strcmp(argv[i], "--x11") == 0)
+        {
+            opts.x11 = true;
+        }
+        else if (std::strcmp(argv[i], "--smooth-scroll") == 0)
+        {
+            opts.smooth_scroll = true;
+        }
+        else if (std::strcmp(argv[i], "--cursor-filter") == 0 && i + 1 < argc)
+        {
+            if (!parse_cursor_filter(argv[++i], opts))
             {
-                send_button_event(dpy, Button1, !pressed);
+                return false;
             }
-
-            // Right click
-            else if (updated_button == button::face_b)
+            opts.cursor_filter_given = true;
+        }
+        else if (std::strcmp(argv[i], "--rates") == 0 && i + 1 < argc)
+        {
+            if (!parse_rates(argv[++i], opts))
             {
-                send_button_event(dpy, Button3, !pressed);
+                return false;
             }
+            opts.rates_given = true;
+        }
+        else if (std::strcmp(argv[i], "--calibrate") == 0)
+        {
+            opts.calibrate = true;
+        }
+        else if (std::strcmp(argv[i], "--adaptive-calibration") == 0)
+        {
+            opts.adaptive_calibration = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
 
-            // Middle click
-            else if (updated_button == button::face_x)
-            {
-                send_button_event(dpy, Button2, !pressed);
-            }
+    if (opts.record_path && opts.replay_path)
+    {
+        return false;
+    }
+    if (opts.calibrate && (opts.replay_path || opts.record_path ||
+                           opts.adaptive_calibration))
+    {
+        return false;
+    }
 
-            // Back
-            else if (updated_button == button::left_bumper)
-            {
-                send_keyboard_event(dpy, XF86XK_Back, !pressed);
-            }
+    // Replays take these from the recording.
+    if (opts.replay_path && (opts.adaptive_calibration || opts.smooth_scroll ||
+                             opts.cursor_filter_given || opts.rates_given ||
+                             opts.profiles_given))
+    {
+        return false;
+    }
+    if (!opts.replay_path && (opts.realtime || opts.x11))
+    {
+        return false;
+    }
+    if (opts.seats_path && (opts.replay_path || opts.record_path ||
+                            opts.calibrate || opts.smooth_scroll ||
+                            opts.adaptive_calibration))
+    {
+        return false;
+    }
+    return true;
+}
 
-            // Forward
-            else if (updated_button == button::right_bumper)
-            {
-                send_keyboard_event(dpy, XF86XK_Forward, !pressed);
-            }
+void load_device_mapping(const options& opts,
+                         const mapping::device_info& device,
+                         mapping::remap& device_map)
+{
+    device_map = mapping::xbox360_remap();
+    bool found = mapping::load(opts.mapping_db_path, device, device_map);
+    std::cout << boost::str(boost::format(
+        found ? "using mapping for %1% (%2%)\n"
+              : "no mapping for %1% (%2%), assuming Xbox 360 layout\n")
+        % device.name % device.guid);
+}
 
-            // Ctrl + w
-            else if (updated_button == button::face_y)
-            {
-                send_keyboard_event(dpy, XK_W, !pressed, ControlMask);
-            }
+int run_calibration(const options& opts)
+{
+    using namespace std::chrono;
 
-            // mute
-            else if (updated_button == button::guide)
-            {
-                send_keyboard_event(dpy, XF86XK_AudioMute, !pressed);
-            }
+    const auto duration = seconds(3);
 
-            // return
-            else if (updated_button == button::back)
-            {
-                send_keyboard_event(dpy, XK_Return, !pressed);
-            }
+    int jsfd = open(joystick_interface, O_RDONLY);
+    if (jsfd < 0)
+    {
+        perror("error opening joystick interface");
+        return EXIT_FAILURE;
+    }
 
-            // space
-            else if (updated_button == button::start)
-            {
-                send_keyboard_event(dpy, XK_space, !pressed);
-            }
+    mapping::device_info device;
+    if (!mapping::identify(jsfd, joystick_interface, device))
+    {
+        perror("error identifying joystick");
+        return EXIT_FAILURE;
+    }
 
-            // left
-            else if (updated_button == button::start)
-            {
-                send_keyboard_event(dpy, XK_Left, !pressed);
-            }
+    mapping::remap device_map;
+    load_device_mapping(opts, device, device_map);
 
-            // up
-            else if (updated_button == button::start)
-            {
-                send_keyboard_event(dpy, XK_Up, !pressed);
-            }
+    output::null_sink out;
+    auto start = clock_type::now();
+    pipeline::translator translator(out, start);
+    translator.set_mapping(&device_map);
 
-            // right
-            else if (updated_button == button::start)
-            {
-                send_keyboard_event(dpy, XK_Right, !pressed);
-            }
+    calibration::estimator estimator(calibration::mode::one_shot,
+                                     xbox360_controller::dead_zones());
 
-            // down
-            else if (updated_button == button::start)
-            {
-                send_keyboard_event(dpy, XK_Down, !pressed);
-            }
+    std::cout << boost::str(boost::format(
+        "calibrating %1%, leave the sticks and triggers alone for %2% s\n")
+        % device.name % duration.count());
 
-            // stick buttons
-            else if (updated_button == button::left_stick)
-            {
-                controller_state.left_stick_down = pressed;
-            }
-            else if (updated_button == button::right_stick)
-            {
-                controller_state.right_stick_down = pressed;
-            }
+    // The state is sampled at the tick rate, like adaptive calibration does.
+    const auto period = nanoseconds(1000000000 / pipeline::update_hz);
+    auto next_sample = start + period;
+    while (next_sample <= start + duration)
+    {
+        auto timeout = duration_cast<milliseconds>(
+            next_sample - clock_type::now()).count();
+
+        pollfd pfd = { jsfd, POLLIN, 0 };
+        int status = poll(&pfd, 1, std::max<int>(timeout, 0));
+        if (status < 0)
+        {
+            perror("poll error");
+            return EXIT_FAILURE;
+        }
 
-            if (controller_state.left_stick_down &&
-                controller_state.right_stick_down)
+        if (status > 0)
+        {
+            js_event ev;
+            if (read(jsfd, &ev, sizeof(ev)) != sizeof(ev))
             {
-                send_keyboard_event(dpy, XK_Escape, false);
-                send_keyboard_event(dpy, XK_Escape, true);
+                perror("error reading joystick event");
+                return EXIT_FAILURE;
             }
+            translator.handle_event(ev);
+        }
 
-            const char* action = (pressed ? "pressed" : "released");
-            std::cout << boost::str(boost::format("[%1%] was %2%\n")
-                    % to_string(updated_button) % action);
-        } break;
-        case JS_EVENT_AXIS:
+        if (clock_type::now() >= next_sample)
         {
-            apply_axis_input(controller_state, ev);
-        } break;
+            estimator.add_sample(translator.state().uncorrected);
+            next_sample += period;
+        }
+    }
+
+    close(jsfd);
+
+    auto zones = estimator.result();
+    std::cout << boost::str(boost::format(
+        "left stick:    center %1$.0f %2$.0f, dead zone %3$.0f\n"
+        "right stick:   center %4$.0f %5$.0f, dead zone %6$.0f\n"
+        "left trigger:  rest %7$.0f, threshold %8$.0f\n"
+        "right trigger: rest %9$.0f, threshold %10$.0f\n")
+        % zones.left_stick_center[0] % zones.left_stick_center[1]
+        % zones.left_stick
+        % zones.right_stick_center[0] % zones.right_stick_center[1]
+        % zones.right_stick
+        % zones.left_trigger_rest % zones.left_trigger_threshold
+        % zones.right_trigger_rest % zones.right_trigger_threshold);
+
+    auto key = calibration::device_key(device.guid, device.name);
+    if (!config::create_directory() ||
+        !calibration::save(opts.calibration_path, key, zones))
+    {
+        perror("error saving calibration");
+        return EXIT_FAILURE;
     }
+
+    return EXIT_SUCCESS;
 }
 
-int main()
+int run_live(const options& opts)
 {
     Display* dpy = XOpenDisplay(nullptr);
     if (dpy == None)
@@ -295,6 +401,23 @@ int main()
         return EXIT_FAILURE;
     }
 
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    if (sigprocmask(SIG_BLOCK, &signals, nullptr) < 0)
+    {
+        perror("error blocking signals");
+        return EXIT_FAILURE;
+    }
+
+    int sfd = signalfd(-1, &signals, 0);
+    if (sfd < 0)
+    {
+        perror("error opening signal interface");
+        return EXIT_FAILURE;
+    }
+
     int tfd = timerfd_create(CLOCK_MONOTONIC, 0);
     if (tfd < 0)
     {
@@ -304,19 +427,18 @@ int main()
 
     epoll_event event;
     event.events = EPOLLIN;
-    event.data.fd = tfd;
-    if (epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &event) < 0)
+    event.data.fd = sfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &event) < 0)
     {
-        perror("error adding timer to epoll");
+        perror("error adding signals to epoll");
         return EXIT_FAILURE;
     }
 
-    itimerspec ts = {};
-    ts.it_interval.tv_nsec = 1000000000 / cursor_update_hz;
-    ts.it_value = ts.it_interval;
-    if (timerfd_settime(tfd, 0, &ts, nullptr) < 0)
+    event.events = EPOLLIN;
+    event.data.fd = tfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &event) < 0)
     {
-        perror("error setting timer");
+        perror("error adding timer to epoll");
         return EXIT_FAILURE;
     }
 
@@ -335,28 +457,231 @@ int main()
         return EXIT_FAILURE;
     }
 
-    xbox360_controller::input_state controller_state = {};
+    mapping::device_info device;
+    if (!mapping::identify(jsfd, joystick_interface, device))
+    {
+        perror("error identifying joystick");
+        return EXIT_FAILURE;
+    }
 
-    float cursor_accel = 0.0f;
-    math::vec2f cursor_accum = { 0.0f, 0.0f };
-    float scroll_accel = 0.0f;
-    float scroll_acum = 0.0f;
-    float volume_down_accel = 0.0f;
-    float volume_up_accel = 0.0f;
-    float volume_acum = 0.0f;
+    mapping::remap device_map;
+    load_device_mapping(opts, device, device_map);
 
-    math::vec2f old_dpad = { 0.0f, 0.0f };
+    auto calibration_key = calibration::device_key(device.guid, device.name);
+    xbox360_controller::dead_zones zones;
+    if (calibration::load(opts.calibration_path, calibration_key, zones))
+    {
+        std::cout << "using stored calibration\n";
+    }
 
-    using namespace std::chrono;
-    using clock_type = steady_clock;
+    calibration::estimator estimator(calibration::mode::adaptive, zones);
+
+    bindings::profile_set profiles;
+    if (!profiles.load(opts.profiles_path))
+    {
+        return EXIT_FAILURE;
+    }
+
+    active_window::tracker window_tracker;
+    if (!window_tracker.open())
+    {
+        perror("error opening display for window tracking");
+        return EXIT_FAILURE;
+    }
+
+    int wfd = window_tracker.fd();
+    event.events = EPOLLIN;
+    event.data.fd = wfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, wfd, &event) < 0)
+    {
+        perror("error adding window tracking to epoll");
+        return EXIT_FAILURE;
+    }
+
+    monitors::layout screen;
+    if (!screen.open())
+    {
+        perror("error opening display for monitor geometry");
+        return EXIT_FAILURE;
+    }
+
+    int mfd = screen.fd();
+    event.events = EPOLLIN;
+    event.data.fd = mfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, mfd, &event) < 0)
+    {
+        perror("error adding monitor geometry to epoll");
+        return EXIT_FAILURE;
+    }
+
+    pipeline::settings config;
+    config.filter_cursor = opts.filter_cursor;
+    config.cursor_filter = opts.cursor_filter;
+    config.rates_hz = opts.rates_hz;
+
+    output::x11_sink x11(dpy);
+    output::uinput_scroll_sink smooth_scroll(x11);
+    output::sink* out = &x11;
+
+    if (opts.smooth_scroll)
+    {
+        if (!smooth_scroll.open())
+        {
+            perror("error creating uinput scroll device");
+            return EXIT_FAILURE;
+        }
+        config.scroll = pipeline::scroll_mode::smooth;
+        out = &smooth_scroll;
+    }
+
+    recording::configuration recorded;
+    recorded.adaptive_calibration = opts.adaptive_calibration;
+    recorded.scroll = config.scroll;
+    recorded.filter_cursor = config.filter_cursor;
+    recorded.cursor_filter = config.cursor_filter;
+    recorded.rates_hz = config.rates_hz;
+
+    recording::writer recorder;
+    if (opts.record_path &&
+        !recorder.open(opts.record_path, device_map, zones, recorded))
+    {
+        perror("error opening recording");
+        return EXIT_FAILURE;
+    }
+
+    auto start = clock_type::now();
+
+    // Nanoseconds since start, the time base of the recording.
+    auto recording_time = [&start]
+    {
+        return std::uint64_t(std::chrono::duration_cast<
+            std::chrono::nanoseconds>(clock_type::now() - start).count());
+    };
+
+    pipeline::translator translator(*out, start, config);
+    translator.set_mapping(&device_map);
+    translator.set_dead_zones(zones);
+    translator.set_screen(&screen.rects(), [&screen](int& x, int& y)
+    {
+        return screen.pointer_position(x, y);
+    });
+
+    // Adaptive calibration samples at the base rate, whatever the pointer
+    // rate is.
+    scheduler::schedule calibration_schedule(start);
+    calibration_schedule.add(pipeline::update_hz);
+
+    state_export::counters daemon_counters = {};
 
-    auto key_repeat_time = milliseconds(250);
-    auto key_repeat_interval = milliseconds(50);
+    // A profile forced through the control socket overrides the one
+    // following the active window.
+    const bindings::profile* active_profile = nullptr;
+    std::string forced_profile;
+    auto select_profile = [&]
+    {
+        auto* selected = profiles.find(forced_profile);
+        if (!selected)
+        {
+            selected = &profiles.select(window_tracker.res_name(),
+                                        window_tracker.res_class());
+        }
+
+        if (selected != active_profile)
+        {
+            active_profile = selected;
+            translator.set_bindings(&selected->buttons);
+            ++daemon_counters.profile_switches;
+
+            // Replays follow the switches, since they have no window to
+            // select profiles by.
+            if (recorder.is_open() &&
+                !recorder.write_bindings(recording_time(), selected->buttons))
+            {
+                perror("error writing recording");
+                recorder.close();
+            }
+            std::cout << boost::str(boost::format("using profile %1%\n")
+                    % selected->name);
+        }
+    };
+    select_profile();
+
+    state_export::publisher state_publisher;
+    auto state_name = state_export::default_name(opts.control_path);
+    if (!state_publisher.open(state_name))
+    {
+        perror("error creating shared memory state");
+        return EXIT_FAILURE;
+    }
+    std::cout << boost::str(boost::format("publishing state in %1%\n")
+            % state_name);
+
+    auto handle_command = [&](const std::string& command) -> std::string
+    {
+        if (command == "stats")
+        {
+            return boost::str(boost::format(
+                "profile %1%\nevents %2%\nticks %3%\ntick_overruns %4%\n"
+                "profile_switches %5%\n")
+                % active_profile->name % daemon_counters.events
+                % daemon_counters.ticks % daemon_counters.tick_overruns
+                % daemon_counters.profile_switches);
+        }
+        else if (command == "reload")
+        {
+            if (!profiles.load(opts.profiles_path))
+            {
+                return "error: invalid profiles, see daemon output\n";
+            }
+
+            // The old tables are gone, so the selection has to be redone.
+            active_profile = nullptr;
+            select_profile();
+
+            // A recording keeps the mapping it started with, so it replays
+            // the same.
+            if (recorder.is_open())
+            {
+                return "ok, mapping kept while recording\n";
+            }
+            load_device_mapping(opts, device, device_map);
+            return "ok\n";
+        }
+        else if (command.compare(0, 8, "profile ") == 0)
+        {
+            auto name = command.substr(8);
+            if (name != "auto" && !profiles.find(name))
+            {
+                return "error: unknown profile\n";
+            }
+
+            forced_profile = (name == "auto" ? std::string() : name);
+            select_profile();
+            return "ok\n";
+        }
+        return "error: unknown command\n";
+    };
+
+    control::server control_server(handle_command);
+    if (!control_server.open(opts.control_path))
+    {
+        perror("error opening control socket");
+        return EXIT_FAILURE;
+    }
+
+    event.events = EPOLLIN;
+    event.data.fd = control_server.fd();
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, control_server.fd(), &event) < 0)
+    {
+        perror("error adding control socket to epoll");
+        return EXIT_FAILURE;
+    }
 
-    auto last_dpad_x = steady_clock::now();
-    auto last_dpad_y = last_dpad_x;
-    bool repeat_dpad_x = false;
-    bool repeat_dpad_y = false;
+    if (!scheduler::arm(tfd, translator.next_deadline()))
+    {
+        perror("error setting timer");
+        return EXIT_FAILURE;
+    }
 
     for(;;)
     {
@@ -367,7 +692,11 @@ int main()
             continue;
         }
 
-        if (event.data.fd == jsfd)
+        if (event.data.fd == sfd)
+        {
+            break;
+        }
+        else if (event.data.fd == jsfd)
         {
             js_event ev;
             ssize_t bytes_read = read(jsfd, &ev, sizeof(ev));
@@ -382,280 +711,888 @@ int main()
                 continue;
             }
 
-            handle_joystick_event(controller_state, ev, dpy);
-        }
-        else if (event.data.fd == tfd)
-        {
-            std::uint64_t expirations;
-            ssize_t bytes_read = read(tfd, &expirations, sizeof(expirations));
-            if (bytes_read < 0)
-            {
-                perror("error reading timer event");
-                break;
-            }
-            if (bytes_read != sizeof(expirations))
+            if (recorder.is_open())
             {
-                std::cerr << "error: short read from timer\n";
-                continue;
+                if (!recorder.write(recording_time(), ev))
+                {
+                    perror("error writing recording");
+                    recorder.close();
+                }
             }
 
-            controller_state.process_dead_zone();
+            ++daemon_counters.events;
 
-            auto corrected = controller_state.corrected;
-            auto left_stick = corrected.left_stick;
-            auto right_stick = corrected.right_stick;
-            auto left_trigger = corrected.left_trigger;
-            auto right_trigger = corrected.right_trigger;
-
-            auto left_magnitude = left_stick.length();
-            if (left_magnitude)
+            if (translator.handle_event(ev) && ev.type == JS_EVENT_BUTTON)
             {
-                left_magnitude = std::pow(left_magnitude, cursor_gamma);
-                left_stick = left_stick.normalized() * left_magnitude;
+                using xbox360_controller::button;
 
-                if (left_magnitude > cursor_accel_threshold)
-                {
-                    cursor_accel += left_magnitude * cursor_accel_factor;
-                    cursor_accel = std::min(cursor_accel, max_cursor_accel);
-                }
-                else if (left_magnitude < cursor_reset_threshold)
-                {
-                    cursor_accel = 1.0f;
-                }
-
-                cursor_accum += cursor_accel * cursor_speed * left_stick;
-
-                if (std::abs(cursor_accum[0]) >= 1.0f ||
-                    std::abs(cursor_accum[1]) >= 1.0f)
+                auto updated_button = static_cast<button>(ev.number);
+                const char* action = (ev.value ? "pressed" : "released");
+                std::cout << boost::str(boost::format("[%1%] was %2%\n")
+                        % to_string(updated_button) % action);
+            }
+        }
+        else if (event.data.fd == mfd)
+        {
+            // The translator reads the rects in place.
+            screen.dispatch();
+        }
+        else if (event.data.fd == wfd)
+        {
+            if (window_tracker.dispatch())
+            {
+                select_profile();
+            }
+        }
+        else if (event.data.fd == control_server.fd())
+        {
+            int cfd = control_server.accept();
+            if (cfd >= 0)
+            {
+                event.events = EPOLLIN;
+                event.data.fd = cfd;
+                if (epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &event) < 0)
                 {
-                    int dx = cursor_accum[0];
-                    int dy = cursor_accum[1];
+                    perror("error adding control client to epoll");
+                }
+            }
+        }
+        else if (control_server.owns(event.data.fd))
+        {
+            control_server.service(event.data.fd);
+        }
+        else if (event.data.fd == tfd)
+        {
+            std::uint64_t expirations;
+            ssize_t bytes_read = read(tfd, &expirations, sizeof(expirations));
+            if (bytes_read < 0)
+            {
+                perror("error reading timer event");
+                break;
+            }
+            if (bytes_read != sizeof(expirations))
+            {
+                std::cerr << "error: short read from timer\n";
+                continue;
+            }
 
-                    XWarpPointer(dpy, None, None, 0, 0, 0, 0, dx, dy);
-                    XSync(dpy, False);
+            JOY2MOUSE_TRACE_SCOPE_ARG("tick", "tick", daemon_counters.ticks);
+            auto now = clock_type::now();
+            translator.tick(now);
 
-                    cursor_accum[0] -= dx;
-                    cursor_accum[1] -= dy;
-                }
+            if (!scheduler::arm(tfd, translator.next_deadline()))
+            {
+                perror("error setting timer");
+                break;
             }
-            else
+
+            if (opts.adaptive_calibration && calibration_schedule.run(now) &&
+                estimator.add_sample(translator.state().uncorrected))
             {
-                cursor_accel = 1.0f;
+                translator.set_dead_zones(estimator.result());
             }
 
-            auto right_magnitude = right_stick.length();
-            if (right_magnitude)
+            ++daemon_counters.ticks;
+            daemon_counters.tick_overruns = translator.overruns();
+            state_publisher.publish(translator, daemon_counters,
+                                    active_profile->name);
+        }
+    }
+
+    if (!recorder.close())
+    {
+        perror("error writing recording");
+    }
+
+    if (opts.adaptive_calibration && estimator.settled())
+    {
+        if (!config::create_directory() ||
+            !calibration::save(opts.calibration_path, calibration_key,
+                               estimator.result()))
+        {
+            perror("error saving calibration");
+        }
+    }
+
+    if (!JOY2MOUSE_TRACE_WRITE(trace_output))
+    {
+        perror("error writing trace");
+    }
+
+    close(jsfd);
+    close(tfd);
+    close(sfd);
+    close(epfd);
+
+    XCloseDisplay(dpy);
+
+    return EXIT_SUCCESS;
+}
+
+int run_replay(const options& opts)
+{
+    using namespace std::chrono;
+
+    std::vector<recording::event> events;
+    std::vector<bindings::table> tables;
+    mapping::remap device_map;
+    xbox360_controller::dead_zones zones;
+    recording::configuration recorded;
+    if (!recording::load(opts.replay_path, events, tables, device_map, zones,
+                         recorded))
+    {
+        perror("error reading recording");
+        return EXIT_FAILURE;
+    }
+
+    pipeline::settings config;
+    config.scroll = recorded.scroll;
+    config.filter_cursor = recorded.filter_cursor;
+    config.cursor_filter = recorded.cursor_filter;
+    config.rates_hz = recorded.rates_hz;
+
+    Display* dpy = nullptr;
+    std::unique_ptr<output::x11_sink> x11;
+    std::unique_ptr<output::uinput_scroll_sink> smooth_scroll;
+    std::unique_ptr<monitors::layout> screen;
+    output::log_sink log(std::cout);
+    output::sink* out = &log;
+
+    if (opts.x11)
+    {
+        dpy = XOpenDisplay(nullptr);
+        if (dpy == None)
+        {
+            perror("error opening display");
+            return EXIT_FAILURE;
+        }
+
+        x11.reset(new output::x11_sink(dpy));
+        out = x11.get();
+
+        screen.reset(new monitors::layout());
+        if (!screen->open())
+        {
+            perror("error opening display for monitor geometry");
+            return EXIT_FAILURE;
+        }
+
+        if (config.scroll == pipeline::scroll_mode::smooth)
+        {
+            smooth_scroll.reset(new output::uinput_scroll_sink(*x11));
+            if (!smooth_scroll->open())
             {
-                right_magnitude = std::pow(right_magnitude, scroll_gamma);
+                perror("error creating uinput scroll device");
+                return EXIT_FAILURE;
+            }
+            out = smooth_scroll.get();
+        }
+    }
 
-                if (right_magnitude > scroll_accel_threshold)
-                {
-                    scroll_accel += right_magnitude * scroll_accel_factor;
-                    scroll_accel = std::min(scroll_accel, max_scroll_accel);
-                }
-                else if (right_magnitude < scroll_reset_threshold)
-                {
-                    scroll_accel = 1.0f;
-                }
+    // The simulated clock starts at the epoch of clock_type and ticks at the
+    // same deadlines as the live timer, so a recording always replays to the
+    // same actions. Events that coincide with a tick are handled before it.
+    const clock_type::time_point start;
+    const std::uint64_t end_ns = events.empty() ? 0 : events.back().time_ns;
 
-                scroll_acum += scroll_accel * scroll_speed
-                    * right_stick[1] / cursor_update_hz;
+    pipeline::translator translator(*out, start, config);
+    translator.set_mapping(&device_map);
+    translator.set_dead_zones(zones);
 
-                // Scroll up
-                while (scroll_acum <= -1.0f)
-                {
-                    send_button_event(dpy, Button4, true);
-                    send_button_event(dpy, Button4, false);
-                    scroll_acum += 1.0f;
-                }
+    // Recordings hold neither the monitors nor the pointer position of the
+    // live run, so without a display to act on, absolute positioning and
+    // jumps are left out rather than replayed against made up geometry.
+    if (screen)
+    {
+        translator.set_screen(&screen->rects(), [&screen](int& x, int& y)
+        {
+            return screen->pointer_position(x, y);
+        });
+    }
 
-                // Scroll down
-                while (scroll_acum >= 1.0f)
-                {
-                    send_button_event(dpy, Button5, true);
-                    send_button_event(dpy, Button5, false);
-                    scroll_acum -= 1.0f;
-                }
+    calibration::estimator estimator(calibration::mode::adaptive, zones);
+    scheduler::schedule calibration_schedule(start);
+    calibration_schedule.add(pipeline::update_hz);
+
+    auto wall_start = clock_type::now();
+    auto pace = [&](std::uint64_t time_ns)
+    {
+        log.set_time(time_ns);
+        if (opts.realtime)
+        {
+            std::this_thread::sleep_until(wall_start + nanoseconds(time_ns));
+        }
+    };
+
+    std::size_t next_event = 0;
+    std::uint64_t ticks = 0;
+    std::uint64_t tick_ns = 0;
+    for (;;)
+    {
+        auto tick = translator.next_deadline();
+        tick_ns = duration_cast<nanoseconds>(tick - start).count();
+
+        while (next_event < events.size() &&
+               events[next_event].time_ns <= tick_ns)
+        {
+            pace(events[next_event].time_ns);
+            js_event ev = events[next_event].js;
+            if (ev.type == recording::bindings_event)
+            {
+                translator.set_bindings(&tables[ev.time]);
             }
             else
             {
-                scroll_accel = 1.0f;
-                scroll_acum = 0.0f;
+                translator.handle_event(ev);
             }
+            ++next_event;
+        }
 
-            if (left_trigger)
-            {
-                left_trigger = std::pow(left_trigger, volume_down_gamma);
+        pace(tick_ns);
+        translator.tick(tick);
+        ++ticks;
 
-                if (left_trigger > volume_down_accel_threshold)
-                {
-                    volume_down_accel += left_trigger * volume_down_accel_factor;
-                    volume_down_accel = std::min(volume_down_accel, max_volume_down_accel);
-                }
-                else if (left_trigger < volume_down_reset_threshold)
-                {
-                    volume_down_accel = 1.0f;
-                }
+        if (recorded.adaptive_calibration && calibration_schedule.run(tick) &&
+            estimator.add_sample(translator.state().uncorrected))
+        {
+            translator.set_dead_zones(estimator.result());
+        }
+
+        if (next_event == events.size() && tick_ns >= end_ns)
+        {
+            break;
+        }
+    }
+
+    auto wall_time = duration_cast<duration<double>>(
+        clock_type::now() - wall_start);
+    std::cerr << boost::str(boost::format(
+        "replayed %1% events in %2% ticks (%3$.3f s simulated) "
+        "in %4$.3f s\n")
+        % (events.size() - tables.size()) % ticks % (tick_ns / 1e9)
+        % wall_time.count());
 
-                volume_acum -= volume_down_accel * volume_down_speed
-                    * left_trigger / cursor_update_hz;
+    if (dpy)
+    {
+        smooth_scroll.reset();
+        x11.reset();
+        XCloseDisplay(dpy);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+// Sources of epoll events in run_seats, in the upper half of data.u64; the
+// lower half holds the seat index.
+enum class seat_source : std::uint32_t
+{
+    signal,
+    timer,
+    joystick,
+    monitors,
+    retry
+};
+
+std::uint64_t seat_event_data(seat_source source, std::size_t index = 0)
+{
+    return std::uint64_t(source) << 32 | index;
+}
+
+// What a seat's translator refers to. Kept apart from seat_state, so the
+// translators can point into it whatever happens to the seat vector.
+struct seat_resources
+{
+    Display* dpy = nullptr;
+    std::unique_ptr<output::sink> out = {};
+    std::unique_ptr<monitors::layout> screen = {};
+    mapping::remap device_map = {};
+
+    // Set by Xlib when a connection of the seat broke.
+    bool display_lost = false;
+};
+
+// Xlib's default handlers exit the process, which would take all seats down
+// with the display of one. Protocol errors are only logged.
+int log_x_error(Display* dpy, XErrorEvent* error)
+{
+    char text[256];
+    XGetErrorText(dpy, error->error_code, text, sizeof(text));
+    std::cerr << boost::str(boost::format("%1%: X error: %2%\n")
+                            % DisplayString(dpy) % text);
+    return 0;
+}
+
+int log_x_io_error(Display* dpy)
+{
+    std::cerr << boost::str(boost::format("%1%: connection lost\n")
+                            % DisplayString(dpy));
+    return 0;
+}
+
+#ifdef JOY2MOUSE_HAVE_IO_ERROR_EXIT_HANDLER
+// Replaces the exit after a broken connection. Xlib turns every later call
+// on the display into a no-op, and the event loop retires the seat.
+void mark_display_lost(Display*, void* display_lost)
+{
+    *static_cast<bool*>(display_lost) = true;
+}
+
+void watch_display(Display* dpy, seat_resources& seat)
+{
+    XSetIOErrorExitHandler(dpy, mark_display_lost, &seat.display_lost);
+}
+#else
+// Without per-display exit handlers Xlib still exits after the log.
+void watch_display(Display*, seat_resources&)
+{
+}
+#endif
+
+// The per-seat state touched on every event and tick, stored contiguously.
+struct seat_state
+{
+    int jsfd;
+    bool active;
+    pipeline::translator translator;
+    std::uint64_t events;
+    std::uint64_t ticks;
+};
+
+int run_seats(const options& opts)
+{
+    std::vector<seats::seat> table;
+    if (!seats::load(opts.seats_path, table))
+    {
+        return EXIT_FAILURE;
+    }
+
+    bindings::profile_set profiles;
+    if (!profiles.load(opts.profiles_path))
+    {
+        return EXIT_FAILURE;
+    }
+    const auto& buttons = profiles.profiles().front().buttons;
+
+    XSetErrorHandler(log_x_error);
+    XSetIOErrorHandler(log_x_io_error);
+
+    int epfd = epoll_create(table.size() + 2);
+    if (epfd < 0)
+    {
+        perror("error opening epoll interface");
+        return EXIT_FAILURE;
+    }
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    if (sigprocmask(SIG_BLOCK, &signals, nullptr) < 0)
+    {
+        perror("error blocking signals");
+        return EXIT_FAILURE;
+    }
+
+    int sfd = signalfd(-1, &signals, 0);
+    if (sfd < 0)
+    {
+        perror("error opening signal interface");
+        return EXIT_FAILURE;
+    }
+
+    int tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (tfd < 0)
+    {
+        perror("error opening timer interface");
+        return EXIT_FAILURE;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = seat_event_data(seat_source::signal);
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &event) < 0)
+    {
+        perror("error adding signals to epoll");
+        return EXIT_FAILURE;
+    }
+
+    event.events = EPOLLIN;
+    event.data.u64 = seat_event_data(seat_source::timer);
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &event) < 0)
+    {
+        perror("error adding timer to epoll");
+        return EXIT_FAILURE;
+    }
+
+    pipeline::settings config;
+    config.filter_cursor = opts.filter_cursor;
+    config.cursor_filter = opts.cursor_filter;
+    config.rates_hz = opts.rates_hz;
+
+    // All translators share the start, so the deadlines of seats active at
+    // the same time coincide and are served by a single wakeup.
+    auto start = clock_type::now();
+
+    std::vector<seat_resources> resources(table.size());
+    std::vector<seat_state> seats;
+    seats.reserve(table.size());
+
+    // Seats waiting for their joystick, which is looked for again every
+    // retry_interval, so a controller plugged in late or back after being
+    // lost is picked up without restarting the other seats.
+    const auto retry_interval = std::chrono::seconds(2);
+    std::vector<std::size_t> missing;
+
+    int rfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (rfd < 0)
+    {
+        perror("error opening timer interface");
+        return EXIT_FAILURE;
+    }
+
+    event.events = EPOLLIN;
+    event.data.u64 = seat_event_data(seat_source::retry);
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, rfd, &event) < 0)
+    {
+        perror("error adding timer to epoll");
+        return EXIT_FAILURE;
+    }
+
+    // Opens the joystick of a seat and sets its translator up for the
+    // device. Returns false with errno set, leaving the seat without one.
+    auto connect = [&](std::size_t index)
+    {
+        const auto& entry = table[index];
+        auto& seat = seats[index];
+
+        int jsfd = open(entry.device.c_str(), O_RDONLY);
+        if (jsfd < 0)
+        {
+            return false;
+        }
+
+        mapping::device_info device;
+        epoll_event joystick_event;
+        joystick_event.events = EPOLLIN;
+        joystick_event.data.u64 = seat_event_data(seat_source::joystick,
+                                                  index);
+        if (!mapping::identify(jsfd, entry.device.c_str(), device) ||
+            epoll_ctl(epfd, EPOLL_CTL_ADD, jsfd, &joystick_event) < 0)
+        {
+            int error = errno;
+            close(jsfd);
+            errno = error;
+            return false;
+        }
+
+        std::cout << boost::str(boost::format("seat %1%: ") % entry.name);
+        load_device_mapping(opts, device, resources[index].device_map);
+
+        xbox360_controller::dead_zones zones;
+        calibration::load(opts.calibration_path,
+                          calibration::device_key(device.guid, device.name),
+                          zones);
+        seat.translator.set_dead_zones(zones);
+
+        seat.jsfd = jsfd;
+        return true;
+    };
+
+    std::size_t serving = 0;
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        const auto& entry = table[i];
+        auto& seat = resources[i];
+
+        // A seat whose output cannot be set up is left out; the others are
+        // still served.
+        bool usable = true;
+        auto skip = [&](const char* what)
+        {
+            perror(boost::str(boost::format("seat %1%: %2%, skipping it")
+                    % entry.name % what).c_str());
+            seat.out.reset(new output::null_sink());
+            seat.screen.reset();
+            usable = false;
+        };
+
+        if (entry.output == seats::output_kind::uinput)
+        {
+            auto out = new output::uinput_sink();
+            seat.out.reset(out);
+            if (!out->open(entry.name))
+            {
+                skip("error creating uinput device");
             }
-            else
+        }
+        else
+        {
+            seat.dpy = XOpenDisplay(entry.display.c_str());
+            if (seat.dpy == None)
             {
-                volume_down_accel = 1.0f;
+                skip("error opening display");
             }
-
-            if (right_trigger)
+            else
             {
-                right_trigger = std::pow(right_trigger, volume_up_gamma);
+                watch_display(seat.dpy, seat);
+                seat.out.reset(new output::x11_sink(seat.dpy));
+                seat.screen.reset(new monitors::layout());
 
-                if (right_trigger > volume_up_accel_threshold)
+                event.events = EPOLLIN;
+                event.data.u64 = seat_event_data(seat_source::monitors, i);
+                if (!seat.screen->open(entry.display.c_str()))
                 {
-                    volume_up_accel += right_trigger * volume_up_accel_factor;
-                    volume_up_accel = std::min(volume_up_accel, max_volume_up_accel);
+                    skip("error opening display for monitor geometry");
                 }
-                else if (right_trigger < volume_up_reset_threshold)
+                else if (epoll_ctl(epfd, EPOLL_CTL_ADD, seat.screen->fd(),
+                                   &event) < 0)
                 {
-                    volume_up_accel = 1.0f;
+                    skip("error adding monitor geometry to epoll");
+                }
+                else
+                {
+                    watch_display(seat.screen->display(), seat);
                 }
-
-                volume_acum += volume_up_accel * volume_up_speed
-                    * right_trigger / cursor_update_hz;
-            }
-            else
-            {
-                volume_up_accel = 1.0f;
             }
+        }
 
-            if (!left_trigger && !right_trigger)
+        seats.push_back({ -1, false,
+                          pipeline::translator(*seat.out, start, config),
+                          0, 0 });
+        auto& translator = seats.back().translator;
+        translator.set_bindings(&buttons);
+        translator.set_mapping(&seat.device_map);
+        if (seat.screen)
+        {
+            auto screen = seat.screen.get();
+            translator.set_screen(&screen->rects(), [screen](int& x, int& y)
             {
-                volume_acum = 0;
-            }
+                return screen->pointer_position(x, y);
+            });
+        }
 
-            // Volume down
-            while (volume_acum <= -1.0f)
-            {
-                send_keyboard_event(dpy, XF86XK_AudioLowerVolume, false);
-                send_keyboard_event(dpy, XF86XK_AudioLowerVolume, true);
-                volume_acum += 1.0f;
-            }
+        if (!usable)
+        {
+            continue;
+        }
+        ++serving;
 
-            // Volume up
-            while (volume_acum >= 1.0f)
-            {
-                send_keyboard_event(dpy, XF86XK_AudioRaiseVolume, false);
-                send_keyboard_event(dpy, XF86XK_AudioRaiseVolume, true);
-                volume_acum -= 1.0f;
-            }
+        if (!connect(i))
+        {
+            perror(boost::str(boost::format(
+                "seat %1%: error opening joystick interface, retrying")
+                % entry.name).c_str());
+            missing.push_back(i);
+        }
+    }
 
-            auto now = clock_type::now();
-            auto dpad = controller_state.dpad;
+    if (!serving)
+    {
+        std::cerr << "error: no seat could be set up\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!missing.empty() &&
+        !scheduler::arm(rfd, clock_type::now() + retry_interval))
+    {
+        perror("error setting timer");
+        return EXIT_FAILURE;
+    }
+
+    // Only seats whose controller is not at rest are ticked, and the timer
+    // is only armed while there are any, so an idle seat costs nothing.
+    std::vector<std::size_t> active;
+    active.reserve(seats.size());
+    std::uint64_t wakeups = 0;
+
+    auto arm_timer = [&]
+    {
+        auto deadline = clock_type::time_point::max();
+        for (auto index : active)
+        {
+            deadline = std::min(deadline,
+                                seats[index].translator.next_deadline());
+        }
+        return active.empty() ? scheduler::disarm(tfd)
+                              : scheduler::arm(tfd, deadline);
+    };
+
+    auto disconnect = [&](std::size_t index)
+    {
+        auto& seat = seats[index];
+        std::cerr << boost::str(boost::format(
+            "seat %1%: joystick lost, retrying\n") % table[index].name);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, seat.jsfd, nullptr);
+        close(seat.jsfd);
+        seat.jsfd = -1;
+
+        if (seat.active)
+        {
+            seat.active = false;
+            active.erase(std::find(active.begin(), active.end(), index));
+        }
+
+        if (missing.empty() &&
+            !scheduler::arm(rfd, clock_type::now() + retry_interval))
+        {
+            perror("error setting timer");
+        }
+        missing.push_back(index);
+    };
+
+    // A display cannot be reconnected, so a seat whose connection broke
+    // stops for good and only its joystick and monitor watch are released.
+    // The other seats go on.
+    auto retire = [&](std::size_t index)
+    {
+        auto& seat = seats[index];
+        auto& resource = resources[index];
+        std::cerr << boost::str(boost::format(
+            "seat %1%: display lost, stopping the seat\n")
+            % table[index].name);
+
+        // Nothing calls into the display any more after this.
+        resource.display_lost = false;
+
+        if (seat.jsfd >= 0)
+        {
+            epoll_ctl(epfd, EPOLL_CTL_DEL, seat.jsfd, nullptr);
+            close(seat.jsfd);
+            seat.jsfd = -1;
+        }
+        if (resource.screen)
+        {
+            epoll_ctl(epfd, EPOLL_CTL_DEL, resource.screen->fd(), nullptr);
+        }
+
+        if (seat.active)
+        {
+            seat.active = false;
+            active.erase(std::find(active.begin(), active.end(), index));
+        }
+        auto waiting = std::find(missing.begin(), missing.end(), index);
+        if (waiting != missing.end())
+        {
+            missing.erase(waiting);
+        }
+    };
 
-            if (dpad[0] != old_dpad[0])
+    for(;;)
+    {
+        int status = epoll_wait(epfd, &event, 1, -1);
+        if (status < 1)
+        {
+            perror("epoll error");
+            continue;
+        }
+
+        auto source = seat_source(event.data.u64 >> 32);
+        auto index = std::size_t(event.data.u64 & 0xffffffff);
+
+        if (source == seat_source::signal)
+        {
+            break;
+        }
+        else if (source == seat_source::joystick)
+        {
+            auto& seat = seats[index];
+
+            js_event ev;
+            ssize_t bytes_read = read(seat.jsfd, &ev, sizeof(ev));
+            if (bytes_read != sizeof(ev))
             {
-                if (old_dpad[0] > 0.5)
+                disconnect(index);
+                if (!arm_timer())
                 {
-                    send_keyboard_event(dpy, XK_Right, true);
-                }
-                else if (old_dpad[0] < -0.5)
-                {
-                    send_keyboard_event(dpy, XK_Left, true);
+                    perror("error setting timer");
+                    break;
                 }
+                continue;
+            }
 
-                if (dpad[0] > 0.5)
+            seat.translator.handle_event(ev);
+            ++seat.events;
+
+            if (resources[index].display_lost)
+            {
+                retire(index);
+                if (!arm_timer())
                 {
-                    send_keyboard_event(dpy, XK_Right, false);
+                    perror("error setting timer");
+                    break;
                 }
-                else if (dpad[0] < -0.5)
+            }
+            else if (!seat.active && !seat.translator.idle())
+            {
+                seat.active = true;
+                seat.translator.resume(clock_type::now());
+                active.push_back(index);
+                if (!arm_timer())
                 {
-                    send_keyboard_event(dpy, XK_Left, false);
+                    perror("error setting timer");
+                    break;
                 }
-
-                last_dpad_x = clock_type::now();
-                repeat_dpad_x = false;
             }
+        }
+        else if (source == seat_source::monitors)
+        {
+            // The translator reads the rects in place.
+            resources[index].screen->dispatch();
 
-            if (dpad[1] != old_dpad[1])
+            if (resources[index].display_lost)
             {
-                if (old_dpad[1] > 0.5)
+                retire(index);
+                if (!arm_timer())
                 {
-                    send_keyboard_event(dpy, XK_Down, true);
-                }
-                else if (old_dpad[1] < -0.5)
-                {
-                    send_keyboard_event(dpy, XK_Up, true);
+                    perror("error setting timer");
+                    break;
                 }
+            }
+        }
+        else if (source == seat_source::retry)
+        {
+            std::uint64_t expirations;
+            if (read(rfd, &expirations, sizeof(expirations))
+                != sizeof(expirations))
+            {
+                continue;
+            }
 
-                if (dpad[1] > 0.5)
+            for (std::size_t i = 0; i < missing.size();)
+            {
+                if (connect(missing[i]))
                 {
-                    send_keyboard_event(dpy, XK_Down, false);
+                    std::cout << boost::str(boost::format(
+                        "seat %1%: joystick connected\n")
+                        % table[missing[i]].name);
+                    missing[i] = missing.back();
+                    missing.pop_back();
                 }
-                else if (dpad[1] < -0.5)
+                else
                 {
-                    send_keyboard_event(dpy, XK_Up, false);
+                    ++i;
                 }
-
-                last_dpad_y = clock_type::now();
-                repeat_dpad_y = false;
             }
 
-            if (!repeat_dpad_x && now - last_dpad_x >= key_repeat_time)
+            if (!missing.empty() &&
+                !scheduler::arm(rfd, clock_type::now() + retry_interval))
+            {
+                perror("error setting timer");
+                break;
+            }
+        }
+        else if (source == seat_source::timer)
+        {
+            std::uint64_t expirations;
+            if (read(tfd, &expirations, sizeof(expirations))
+                != sizeof(expirations))
             {
-                repeat_dpad_x = true;
-                last_dpad_x += key_repeat_time - key_repeat_interval;
+                continue;
             }
 
-            if (repeat_dpad_x)
+            JOY2MOUSE_TRACE_SCOPE_ARG("tick", "active", active.size());
+            ++wakeups;
+
+            auto now = clock_type::now();
+            for (std::size_t i = 0; i < active.size();)
             {
-                while (now - last_dpad_x >= key_repeat_interval)
+                auto& seat = seats[active[i]];
+                if (seat.translator.next_deadline() > now)
                 {
-                    if (dpad[0] > 0.5)
-                    {
-                        send_keyboard_event(dpy, XK_Right, true);
-                        send_keyboard_event(dpy, XK_Right, false);
-                    }
-                    else if (dpad[0] < -0.5)
-                    {
-                        send_keyboard_event(dpy, XK_Left, true);
-                        send_keyboard_event(dpy, XK_Left, false);
-                    }
-
-                    last_dpad_x += key_repeat_interval;
+                    ++i;
+                    continue;
                 }
-            }
 
-            if (!repeat_dpad_y && now - last_dpad_y >= key_repeat_time)
-            {
-                repeat_dpad_y = true;
-                last_dpad_y += key_repeat_time - key_repeat_interval;
-            }
+                seat.translator.tick(now);
+                ++seat.ticks;
 
-            if (repeat_dpad_y)
-            {
-                while (now - last_dpad_y >= key_repeat_interval)
+                if (resources[active[i]].display_lost)
+                {
+                    // Takes the seat out of active.
+                    retire(active[i]);
+                }
+                else if (seat.translator.idle())
                 {
-                    if (dpad[1] > 0.5)
-                    {
-                        send_keyboard_event(dpy, XK_Down, true);
-                        send_keyboard_event(dpy, XK_Down, false);
-                    }
-                    else if (dpad[1] < -0.5)
-                    {
-                        send_keyboard_event(dpy, XK_Up, true);
-                        send_keyboard_event(dpy, XK_Up, false);
-                    }
-
-                    last_dpad_y += key_repeat_interval;
+                    seat.active = false;
+                    active[i] = active.back();
+                    active.pop_back();
+                }
+                else
+                {
+                    ++i;
                 }
             }
 
-            old_dpad = dpad;
+            if (!arm_timer())
+            {
+                perror("error setting timer");
+                break;
+            }
         }
     }
 
-    close(jsfd);
+    std::cout << boost::str(boost::format("%1% wakeups\n") % wakeups);
+    for (std::size_t i = 0; i < seats.size(); ++i)
+    {
+        std::cout << boost::str(boost::format(
+            "seat %1%: %2% events, %3% ticks, %4% overruns\n")
+            % table[i].name % seats[i].events % seats[i].ticks
+            % seats[i].translator.overruns());
+    }
+
+    if (!JOY2MOUSE_TRACE_WRITE(trace_output))
+    {
+        perror("error writing trace");
+    }
+
+    for (std::size_t i = 0; i < seats.size(); ++i)
+    {
+        if (seats[i].jsfd >= 0)
+        {
+            close(seats[i].jsfd);
+        }
+    }
+    seats.clear();
+
+    for (auto& seat : resources)
+    {
+        seat.screen.reset();
+        seat.out.reset();
+        if (seat.dpy)
+        {
+            XCloseDisplay(seat.dpy);
+        }
+    }
+
+    close(rfd);
+    close(tfd);
+    close(sfd);
     close(epfd);
 
-    XCloseDisplay(dpy);
+    return EXIT_SUCCESS;
 }
 
+int main(int argc, char** argv)
+{
+    options opts;
+    if (!parse_options(argc, argv, opts))
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (opts.replay_path)
+    {
+        return run_replay(opts);
+    }
+    if (opts.calibrate)
+    {
+        return run_calibration(opts);
+    }
+    if (opts.seats_path)
+    {
+        return run_seats(opts);
+    }
+
+    return run_live(opts);
+}
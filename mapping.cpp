@@ -0,0 +1,350 @@
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+
+#include <fstream>
+#include <string>
+
+#include "mapping.hpp"
+#include "xbox360_controller.hpp"
+
+namespace mapping {
+
+namespace {
+
+using xbox360_controller::axis;
+using xbox360_controller::button;
+
+constexpr target no_target = { target_kind::none, 0, 0, 0 };
+
+remap make_xbox360_remap()
+{
+    remap result;
+    result.buttons.fill(no_target);
+    result.axes.fill(no_target);
+
+    for (std::size_t i = 0; i < xbox360_controller::button_count; ++i)
+    {
+        result.buttons[i] = { target_kind::button, std::uint8_t(i), 1, 0 };
+    }
+    for (std::size_t i = 0; i < xbox360_controller::axis_count; ++i)
+    {
+        result.axes[i] = { target_kind::axis, std::uint8_t(i), 1, 0 };
+    }
+
+    return result;
+}
+
+bool read_sysfs_id(const std::string& device, const char* field,
+                   unsigned& value)
+{
+    std::ifstream in("/sys/class/input/" + device + "/device/id/" + field);
+    return bool(in >> std::hex >> value);
+}
+
+bool is_hat(std::uint8_t code)
+{
+    return code >= ABS_HAT0X && code <= ABS_HAT3Y;
+}
+
+// What an SDL mapping key drives in the Xbox 360 layout.
+struct output_binding
+{
+    const char* key;
+    target_kind kind;
+    std::uint8_t index;
+
+    // For d-pad directions, the sign of the direction on its axis.
+    std::int8_t direction;
+};
+
+const output_binding output_bindings[] = {
+    { "a", target_kind::button, std::uint8_t(button::face_a), 0 },
+    { "b", target_kind::button, std::uint8_t(button::face_b), 0 },
+    { "x", target_kind::button, std::uint8_t(button::face_x), 0 },
+    { "y", target_kind::button, std::uint8_t(button::face_y), 0 },
+    { "back", target_kind::button, std::uint8_t(button::back), 0 },
+    { "guide", target_kind::button, std::uint8_t(button::guide), 0 },
+    { "start", target_kind::button, std::uint8_t(button::start), 0 },
+    { "leftstick", target_kind::button, std::uint8_t(button::left_stick), 0 },
+    { "rightstick", target_kind::button,
+        std::uint8_t(button::right_stick), 0 },
+    { "leftshoulder", target_kind::button,
+        std::uint8_t(button::left_bumper), 0 },
+    { "rightshoulder", target_kind::button,
+        std::uint8_t(button::right_bumper), 0 },
+    { "leftx", target_kind::axis, std::uint8_t(axis::left_stick_x), 0 },
+    { "lefty", target_kind::axis, std::uint8_t(axis::left_stick_y), 0 },
+    { "rightx", target_kind::axis, std::uint8_t(axis::right_stick_x), 0 },
+    { "righty", target_kind::axis, std::uint8_t(axis::right_stick_y), 0 },
+    { "lefttrigger", target_kind::axis, std::uint8_t(axis::left_trigger), 0 },
+    { "righttrigger", target_kind::axis,
+        std::uint8_t(axis::right_trigger), 0 },
+    { "dpup", target_kind::axis, std::uint8_t(axis::dpad_y), -1 },
+    { "dpdown", target_kind::axis, std::uint8_t(axis::dpad_y), 1 },
+    { "dpleft", target_kind::axis, std::uint8_t(axis::dpad_x), -1 },
+    { "dpright", target_kind::axis, std::uint8_t(axis::dpad_x), 1 },
+};
+
+// Returns the js axis of SDL's axis number n, which skips hats.
+int sdl_axis_to_js(const device_info& info, int n)
+{
+    for (std::size_t i = 0; i < info.axis_codes.size(); ++i)
+    {
+        if (!is_hat(info.axis_codes[i]) && n-- == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int hat_axis_to_js(const device_info& info, std::uint8_t code)
+{
+    for (std::size_t i = 0; i < info.axis_codes.size(); ++i)
+    {
+        if (info.axis_codes[i] == code)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Compiles one "key:source" element of a mapping. Unknown keys and sources
+// the device does not have are skipped.
+void compile_element(const device_info& info, const std::string& key,
+                     std::string source, remap& result)
+{
+    const output_binding* to = nullptr;
+    for (const auto& binding : output_bindings)
+    {
+        if (key == binding.key)
+        {
+            to = &binding;
+        }
+    }
+    if (!to || source.empty())
+    {
+        return;
+    }
+
+    // "+a2"/"-a2" select half of an input axis, "a2~" inverts it.
+    std::int8_t half = 1;
+    bool half_axis = false;
+    if (source[0] == '+' || source[0] == '-')
+    {
+        half = (source[0] == '-' ? -1 : 1);
+        half_axis = true;
+        source.erase(0, 1);
+    }
+    std::int8_t invert = 1;
+    if (!source.empty() && source.back() == '~')
+    {
+        invert = -1;
+        source.pop_back();
+    }
+    if (source.size() < 2)
+    {
+        return;
+    }
+
+    try
+    {
+        if (source[0] == 'b')
+        {
+            int number = std::stoi(source.substr(1));
+            if (number < 0 || number > 255)
+            {
+                return;
+            }
+
+            // A button driving a trigger is released at the negative end
+            // of the axis, like the trigger axes.
+            bool trigger = to->kind == target_kind::axis &&
+                (to->index == std::uint8_t(axis::left_trigger) ||
+                 to->index == std::uint8_t(axis::right_trigger));
+            std::int8_t scale = to->direction ? to->direction : 1;
+            result.buttons[number] = { to->kind, to->index, scale,
+                                       std::int8_t(trigger ? 1 : 0) };
+        }
+        else if (source[0] == 'a')
+        {
+            int number = sdl_axis_to_js(info, std::stoi(source.substr(1)));
+            if (number < 0)
+            {
+                return;
+            }
+
+            // Directions and buttons take the half as it is; a half driving
+            // a whole stick or trigger axis is stretched to its full range.
+            std::int8_t scale = to->kind == target_kind::button
+                ? half
+                : std::int8_t(invert * (to->direction ? to->direction * half
+                                                      : 1));
+            std::int8_t stretch = to->kind == target_kind::axis
+                && !to->direction && half_axis ? half : 0;
+            result.axes[number] = { to->kind, to->index, scale, stretch };
+        }
+        else if (source[0] == 'h')
+        {
+            auto dot = source.find('.');
+            if (dot == std::string::npos || !to->direction)
+            {
+                return;
+            }
+
+            int hat = std::stoi(source.substr(1, dot - 1));
+            int mask = std::stoi(source.substr(dot + 1));
+            if (hat < 0 || hat > 3)
+            {
+                return;
+            }
+
+            // Hat masks are 1 up, 2 right, 4 down and 8 left.
+            bool vertical = mask == 1 || mask == 4;
+            bool negative = mask == 1 || mask == 8;
+            int number = hat_axis_to_js(
+                info, ABS_HAT0X + 2 * hat + (vertical ? 1 : 0));
+            if (number < 0)
+            {
+                return;
+            }
+
+            std::int8_t scale = (negative == (to->direction < 0)) ? 1 : -1;
+            result.axes[number] = { to->kind, to->index, scale, 0 };
+        }
+    }
+    catch (const std::exception&)
+    {
+        // Malformed numbers leave the element unmapped.
+    }
+}
+
+bool guid_matches(const std::string& entry, const std::string& device)
+{
+    // Characters 4 to 7 hold the CRC of the name in newer SDL versions.
+    return entry.size() == 32 && device.size() == 32
+        && boost::iequals(entry.substr(0, 4), device.substr(0, 4))
+        && boost::iequals(entry.substr(8), device.substr(8));
+}
+
+} // namespace
+
+const remap& xbox360_remap()
+{
+    static const remap result = make_xbox360_remap();
+    return result;
+}
+
+bool identify(int jsfd, const char* interface, device_info& info)
+{
+    char name[128] = {};
+    if (ioctl(jsfd, JSIOCGNAME(sizeof(name) - 1), name) < 0)
+    {
+        return false;
+    }
+    info.name = name;
+
+    std::uint8_t axis_count = 0;
+    std::uint8_t axis_codes[ABS_CNT] = {};
+    if (ioctl(jsfd, JSIOCGAXES, &axis_count) < 0 ||
+        ioctl(jsfd, JSIOCGAXMAP, axis_codes) < 0)
+    {
+        return false;
+    }
+    info.axis_codes.assign(axis_codes, axis_codes + axis_count);
+
+    std::string device = interface;
+    device = device.substr(device.rfind('/') + 1);
+
+    unsigned bus, vendor, product, version;
+    info.guid.clear();
+    if (read_sysfs_id(device, "bustype", bus) &&
+        read_sysfs_id(device, "vendor", vendor) &&
+        read_sysfs_id(device, "product", product) &&
+        read_sysfs_id(device, "version", version))
+    {
+        // Little endian 16 bit fields, each followed by a zero word.
+        auto le16 = [](unsigned value)
+        {
+            return boost::str(boost::format("%02x%02x0000")
+                    % (value & 0xff) % ((value >> 8) & 0xff));
+        };
+        info.guid = le16(bus) + le16(vendor) + le16(product) + le16(version);
+    }
+
+    return true;
+}
+
+bool load(const std::string& db_path, const device_info& info, remap& result)
+{
+    std::ifstream in(db_path);
+    if (!in)
+    {
+        return false;
+    }
+
+    std::string entry;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        boost::trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        boost::split(fields, line, boost::is_any_of(","));
+        if (fields.size() < 3)
+        {
+            continue;
+        }
+
+        if (line.find("platform:") != std::string::npos &&
+            line.find("platform:Linux") == std::string::npos)
+        {
+            continue;
+        }
+
+        if (!info.guid.empty() && guid_matches(fields[0], info.guid))
+        {
+            entry = line;
+            break;
+        }
+        if (entry.empty() && fields[1] == info.name)
+        {
+            entry = line;
+        }
+    }
+
+    if (entry.empty())
+    {
+        return false;
+    }
+
+    std::vector<std::string> fields;
+    boost::split(fields, entry, boost::is_any_of(","));
+
+    remap compiled;
+    compiled.buttons.fill(no_target);
+    compiled.axes.fill(no_target);
+
+    for (std::size_t i = 2; i < fields.size(); ++i)
+    {
+        auto colon = fields[i].find(':');
+        if (colon != std::string::npos)
+        {
+            compile_element(info, fields[i].substr(0, colon),
+                            fields[i].substr(colon + 1), compiled);
+        }
+    }
+
+    result = compiled;
+    return true;
+}
+
+} // namespace mapping
@@ -0,0 +1,120 @@
+#ifndef JOY2MOUSE_MAPPING_HPP
+#define JOY2MOUSE_MAPPING_HPP
+
+#include <linux/joystick.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mapping {
+
+enum class target_kind : std::uint8_t
+{
+    none,
+    button,
+    axis
+};
+
+// Where a device button or axis goes in the Xbox 360 layout the pipeline
+// works with.
+struct target
+{
+    target_kind kind;
+
+    // xbox360_controller::button or axis.
+    std::uint8_t index;
+
+    // Axis direction; for buttons driving an axis (d-pads) the value of the
+    // axis while pressed, for axes driving a button the pressed side.
+    std::int8_t scale;
+
+    // For half of an input axis driving a whole axis, the side used, which
+    // is stretched over the full range before scale applies. For a button
+    // driving a trigger 1, so released is the negative end like a released
+    // trigger axis. Else 0.
+    std::int8_t half;
+};
+
+// Flat per-device remap tables indexed by js event number.
+struct remap
+{
+    std::array<target, 256> buttons;
+    std::array<target, 256> axes;
+
+    // Rewrites a raw event into the Xbox 360 layout. Returns false if the
+    // event does not map to anything.
+    bool apply(js_event& ev) const
+    {
+        bool from_button = (ev.type & ~JS_EVENT_INIT) == JS_EVENT_BUTTON;
+        const target& to = from_button ? buttons[ev.number] : axes[ev.number];
+
+        switch (to.kind)
+        {
+            case target_kind::none:
+                return false;
+
+            case target_kind::button:
+                if (!from_button)
+                {
+                    ev.value = ev.value * to.scale > 16384;
+                }
+                ev.type = (ev.type & JS_EVENT_INIT) | JS_EVENT_BUTTON;
+                break;
+
+            case target_kind::axis:
+                if (from_button)
+                {
+                    int released = to.half ? -32767 : 0;
+                    ev.value = to.scale * (ev.value ? 32767 : released);
+                }
+                else if (to.half)
+                {
+                    int value = 2 * std::max(ev.value * to.half, 0) - 32767;
+                    ev.value = value * to.scale;
+                }
+                else
+                {
+                    ev.value = ev.value * to.scale;
+                }
+                ev.type = (ev.type & JS_EVENT_INIT) | JS_EVENT_AXIS;
+                break;
+        }
+
+        ev.number = to.index;
+        return true;
+    }
+};
+
+// The kernel xpad layout of an Xbox 360 pad, passed through unchanged.
+// Indices outside of it are dropped.
+const remap& xbox360_remap();
+
+struct device_info
+{
+    std::string name = {};
+
+    // SDL joystick GUID built from the input id, as 32 hex digits.
+    std::string guid = {};
+
+    // ABS_* code of every js axis, from JSIOCGAXMAP.
+    std::vector<std::uint8_t> axis_codes = {};
+};
+
+// Reads the identity of an opened js device. The input id comes from sysfs,
+// which has the same values as EVIOCGID on the matching event device but
+// needs no access to it.
+bool identify(int jsfd, const char* interface, device_info& info);
+
+// Looks up a device in an SDL gamecontrollerdb file and compiles its entry
+// into remap tables. Returns false if the file cannot be read or has no
+// entry for the device; the result is then left alone. Entries match by
+// GUID, ignoring the name checksum newer SDL versions put in it, or else
+// by name.
+bool load(const std::string& db_path, const device_info& info, remap& result);
+
+} // namespace mapping
+
+#endif // !defined(JOY2MOUSE_MAPPING_HPP)
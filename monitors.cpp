@@ -0,0 +1,167 @@
+#ifdef JOY2MOUSE_HAVE_XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif
+
+#include <algorithm>
+
+#include "monitors.hpp"
+#include "trace.hpp"
+
+namespace monitors {
+
+layout::layout()
+    : dpy(nullptr), randr_event_base(-1), screen_width(0), screen_height(0),
+      monitors()
+{
+}
+
+layout::~layout()
+{
+    if (dpy)
+    {
+        XCloseDisplay(dpy);
+    }
+}
+
+bool layout::open(const char* display_name)
+{
+    dpy = XOpenDisplay(display_name);
+    if (!dpy)
+    {
+        return false;
+    }
+
+    Window root = DefaultRootWindow(dpy);
+    screen_width = DisplayWidth(dpy, DefaultScreen(dpy));
+    screen_height = DisplayHeight(dpy, DefaultScreen(dpy));
+
+#ifdef JOY2MOUSE_HAVE_XRANDR
+    int error_base;
+    int major = 0;
+    int minor = 0;
+    if (XRRQueryExtension(dpy, &randr_event_base, &error_base) &&
+        XRRQueryVersion(dpy, &major, &minor) &&
+        (major > 1 || (major == 1 && minor >= 5)))
+    {
+        XRRSelectInput(dpy, root, RRScreenChangeNotifyMask);
+    }
+    else
+    {
+        randr_event_base = -1;
+    }
+#endif
+
+    if (randr_event_base < 0)
+    {
+        XSelectInput(dpy, root, StructureNotifyMask);
+    }
+
+    update();
+    XFlush(dpy);
+    return true;
+}
+
+int layout::fd() const
+{
+    return ConnectionNumber(dpy);
+}
+
+bool layout::dispatch()
+{
+    JOY2MOUSE_TRACE_SCOPE("monitors");
+
+    // update() makes a round trip, which can queue further notifications
+    // without the descriptor becoming readable again, so the queue is
+    // drained until it stays empty.
+    bool changed = false;
+    for (;;)
+    {
+        bool notified = false;
+        while (XPending(dpy))
+        {
+            XEvent event;
+            XNextEvent(dpy, &event);
+
+#ifdef JOY2MOUSE_HAVE_XRANDR
+            if (randr_event_base >= 0 &&
+                event.type == randr_event_base + RRScreenChangeNotify)
+            {
+                XRRUpdateConfiguration(&event);
+                screen_width = DisplayWidth(dpy, DefaultScreen(dpy));
+                screen_height = DisplayHeight(dpy, DefaultScreen(dpy));
+                notified = true;
+            }
+#endif
+
+            if (event.type == ConfigureNotify &&
+                event.xconfigure.window == DefaultRootWindow(dpy))
+            {
+                screen_width = event.xconfigure.width;
+                screen_height = event.xconfigure.height;
+                notified = true;
+            }
+        }
+
+        if (!notified)
+        {
+            return changed;
+        }
+        changed = update() || changed;
+    }
+}
+
+bool layout::pointer_position(int& x, int& y) const
+{
+    Window root;
+    Window child;
+    int window_x;
+    int window_y;
+    unsigned mask;
+    return XQueryPointer(dpy, DefaultRootWindow(dpy), &root, &child, &x, &y,
+                         &window_x, &window_y, &mask);
+}
+
+bool layout::update()
+{
+    std::vector<rect> found;
+
+#ifdef JOY2MOUSE_HAVE_XRANDR
+    if (randr_event_base >= 0)
+    {
+        int count = 0;
+        XRRMonitorInfo* info =
+            XRRGetMonitors(dpy, DefaultRootWindow(dpy), True, &count);
+        for (int i = 0; i < count; ++i)
+        {
+            found.push_back({ info[i].x, info[i].y,
+                              info[i].width, info[i].height });
+        }
+        if (info)
+        {
+            XRRFreeMonitors(info);
+        }
+    }
+#endif
+
+    if (found.empty())
+    {
+        found.push_back({ 0, 0, screen_width, screen_height });
+    }
+
+    std::sort(found.begin(), found.end(), [](const rect& a, const rect& b)
+    {
+        return a.x != b.x ? a.x < b.x : a.y < b.y;
+    });
+
+    bool changed = found.size() != monitors.size() ||
+        !std::equal(found.begin(), found.end(), monitors.begin(),
+                    [](const rect& a, const rect& b)
+                    {
+                        return a.x == b.x && a.y == b.y &&
+                            a.width == b.width && a.height == b.height;
+                    });
+    monitors = std::move(found);
+    return changed;
+}
+
+} // namespace monitors
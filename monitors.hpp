@@ -0,0 +1,92 @@
+#ifndef JOY2MOUSE_MONITORS_HPP
+#define JOY2MOUSE_MONITORS_HPP
+
+#include <X11/Xlib.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace monitors {
+
+// Area of a monitor in root window coordinates.
+struct rect
+{
+    int x;
+    int y;
+    int width;
+    int height;
+
+    bool contains(int px, int py) const
+    {
+        return px >= x && px < x + width && py >= y && py < y + height;
+    }
+};
+
+// Returns the index of the monitor containing the point, or 0 if none does.
+inline std::size_t find(const std::vector<rect>& monitors, int x, int y)
+{
+    for (std::size_t i = 0; i < monitors.size(); ++i)
+    {
+        if (monitors[i].contains(x, y))
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// Caches the geometry of the monitors of the default screen.
+//
+// The geometry is read from XRandR once and again only on
+// RRScreenChangeNotify, so using it costs no requests. Without XRandR
+// support the whole screen is one monitor, refreshed when the root window
+// is resized.
+//
+// Uses its own display connection, like active_window::tracker.
+class layout
+{
+public:
+    layout();
+    ~layout();
+
+    layout(const layout&) = delete;
+    layout& operator= (const layout&) = delete;
+
+    // Connects to a display, by default the one in $DISPLAY, and reads the
+    // monitors.
+    bool open(const char* display_name = nullptr);
+
+    // File descriptor to wait on for changes.
+    int fd() const;
+
+    // The connection itself, null until open.
+    Display* display() const
+    {
+        return dpy;
+    }
+
+    // Handles all pending X events. Returns true if the geometry changed.
+    bool dispatch();
+
+    // Sorted by left edge, then top edge; never empty once open.
+    const std::vector<rect>& rects() const
+    {
+        return monitors;
+    }
+
+    // Queries the pointer position, which takes a round trip.
+    bool pointer_position(int& x, int& y) const;
+
+private:
+    bool update();
+
+    Display* dpy;
+    int randr_event_base;
+    int screen_width;
+    int screen_height;
+    std::vector<rect> monitors;
+};
+
+} // namespace monitors
+
+#endif // !defined(JOY2MOUSE_MONITORS_HPP)
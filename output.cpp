@@ -0,0 +1,47 @@
+#include <boost/format.hpp>
+
+#include "output.hpp"
+
+namespace output {
+
+log_sink::log_sink(std::ostream& out)
+    : out(out), time_ns(0)
+{
+}
+
+void log_sink::set_time(std::uint64_t time_ns)
+{
+    this->time_ns = time_ns;
+}
+
+void log_sink::move_pointer(int dx, int dy)
+{
+    out << boost::str(boost::format("%1% move %2% %3%\n")
+            % time_ns % dx % dy);
+}
+
+void log_sink::warp_pointer(int x, int y)
+{
+    out << boost::str(boost::format("%1% warp %2% %3%\n")
+            % time_ns % x % y);
+}
+
+void log_sink::button(unsigned button, bool release)
+{
+    out << boost::str(boost::format("%1% button %2% %3%\n")
+            % time_ns % button % (release ? "release" : "press"));
+}
+
+void log_sink::key(unsigned keysym, bool release, unsigned state)
+{
+    out << boost::str(boost::format("%1% key 0x%2$x %3% 0x%4$x\n")
+            % time_ns % keysym % (release ? "release" : "press") % state);
+}
+
+void log_sink::scroll(float horizontal, float vertical)
+{
+    out << boost::str(boost::format("%1% scroll %2$.4f %3$.4f\n")
+            % time_ns % horizontal % vertical);
+}
+
+} // namespace output
@@ -0,0 +1,59 @@
+#ifndef JOY2MOUSE_OUTPUT_HPP
+#define JOY2MOUSE_OUTPUT_HPP
+
+#include <cstdint>
+#include <ostream>
+
+namespace output {
+
+// Destination for the actions produced by the translation pipeline.
+class sink
+{
+public:
+    virtual ~sink() = default;
+
+    virtual void move_pointer(int dx, int dy) = 0;
+
+    // Moves the pointer to a position in root window coordinates.
+    virtual void warp_pointer(int x, int y) = 0;
+
+    virtual void button(unsigned button, bool release) = 0;
+    virtual void key(unsigned keysym, bool release, unsigned state = 0) = 0;
+
+    // Scrolls by fractional wheel notches; positive is right and down.
+    virtual void scroll(float horizontal, float vertical) = 0;
+};
+
+// Discards every action.
+class null_sink : public sink
+{
+public:
+    void move_pointer(int, int) override {}
+    void warp_pointer(int, int) override {}
+    void button(unsigned, bool) override {}
+    void key(unsigned, bool, unsigned) override {}
+    void scroll(float, float) override {}
+};
+
+// Writes one line per action, prefixed with the time set by the caller.
+class log_sink : public sink
+{
+public:
+    explicit log_sink(std::ostream& out);
+
+    void set_time(std::uint64_t time_ns);
+
+    void move_pointer(int dx, int dy) override;
+    void warp_pointer(int x, int y) override;
+    void button(unsigned button, bool release) override;
+    void key(unsigned keysym, bool release, unsigned state) override;
+    void scroll(float horizontal, float vertical) override;
+
+private:
+    std::ostream& out;
+    std::uint64_t time_ns;
+};
+
+} // namespace output
+
+#endif // !defined(JOY2MOUSE_OUTPUT_HPP)
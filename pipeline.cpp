@@ -0,0 +1,747 @@
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/XF86keysym.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "pipeline.hpp"
+#include "trace.hpp"
+
+namespace pipeline {
+
+namespace {
+
+// Core pointer buttons for horizontal scrolling, which Xlib has no names for.
+constexpr unsigned scroll_left_button = 6;
+constexpr unsigned scroll_right_button = 7;
+
+// Speeds and acceleration factors are per second.
+constexpr float cursor_speed = 15 * update_hz;
+constexpr float cursor_gamma = 2.5f;
+constexpr float cursor_accel_threshold = 0.25f;
+constexpr float cursor_reset_threshold = 0.2f;
+constexpr float max_cursor_accel = 2.5f;
+constexpr float cursor_accel_time = 2.0f;
+constexpr float cursor_accel_factor =
+    cursor_accel_time * (max_cursor_accel - 1.0f);
+
+constexpr float scroll_speed = 7;
+constexpr float scroll_gamma = 3.0f;
+constexpr float scroll_accel_threshold = 0.25f;
+constexpr float scroll_reset_threshold = 0.2f;
+constexpr float max_scroll_accel = 4.0f;
+constexpr float scroll_accel_time = 2.0f;
+constexpr float scroll_accel_factor =
+    scroll_accel_time * (max_scroll_accel - 1.0f);
+
+constexpr float volume_up_speed = 7;
+constexpr float volume_up_gamma = 3.0f;
+constexpr float volume_up_accel_threshold = 0.25f;
+constexpr float volume_up_reset_threshold = 0.2f;
+constexpr float max_volume_up_accel = 4.0f;
+constexpr float volume_up_accel_time = 2.0f;
+constexpr float volume_up_accel_factor =
+    volume_up_accel_time * (max_volume_up_accel - 1.0f);
+
+constexpr float volume_down_speed = 7;
+constexpr float volume_down_gamma = 3.0f;
+constexpr float volume_down_accel_threshold = 0.25f;
+constexpr float volume_down_reset_threshold = 0.2f;
+constexpr float max_volume_down_accel = 4.0f;
+constexpr float volume_down_accel_time = 2.0f;
+constexpr float volume_down_accel_factor =
+    volume_down_accel_time * (max_volume_down_accel - 1.0f);
+
+void apply_axis_input(xbox360_controller::input_state& controller_state,
+                      js_event ev)
+{
+    using xbox360_controller::axis;
+
+    JOY2MOUSE_TRACE_SCOPE_ARG("apply_axis_input", "axis", ev.number);
+
+    auto& uncorrected = controller_state.uncorrected;
+    auto value = ev.value;
+
+    auto updated_axis = static_cast<axis>(ev.number);
+    switch (updated_axis)
+    {
+        case axis::left_stick_x:
+            uncorrected.left_stick[0] = value;
+            break;
+
+        case axis::left_stick_y:
+            uncorrected.left_stick[1] = value;
+            break;
+
+        case axis::left_trigger:
+            uncorrected.left_trigger = value;
+            break;
+
+        case axis::right_stick_x:
+            uncorrected.right_stick[0] = value;
+            break;
+
+        case axis::right_stick_y:
+            uncorrected.right_stick[1] = value;
+            break;
+
+        case axis::right_trigger:
+            uncorrected.right_trigger = value;
+            break;
+
+        case axis::dpad_x:
+            controller_state.dpad[0] = value / 32767.0f;
+            break;
+
+        case axis::dpad_y:
+            controller_state.dpad[1] = value / 32767.0f;
+            break;
+    }
+}
+
+} // namespace
+
+translator::translator(output::sink& out, clock_type::time_point start,
+                       const settings& config)
+    : out(out),
+      config(config),
+      schedule(start),
+      controller_state(),
+      channel{ 0.0f, { 0.0f, 0.0f }, 0.0f, { 0.0f, 0.0f }, 0.0f, 0.0f, 0.0f },
+      cursor_filter{ { filter::one_euro(config.cursor_filter[0]),
+                       filter::one_euro(config.cursor_filter[1]) } },
+      old_dpad{ 0.0f, 0.0f },
+      last_dpad_x(start),
+      last_dpad_y(start),
+      repeat_dpad_x(false),
+      repeat_dpad_y(false),
+      screen(nullptr),
+      locate_pointer(),
+      absolute_pointer(false),
+      absolute_started(false),
+      absolute_monitor(0),
+      last_warp_x(INT_MIN),
+      last_warp_y(INT_MIN),
+      device_map(&mapping::xbox360_remap()),
+      buttons(&bindings::default_table()),
+      held_actions()
+{
+    held_actions.fill({ bindings::action_type::none, 0, 0 });
+
+    // Tasks are added in output_channel order, so their indices match.
+    for (auto rate_hz : config.rates_hz)
+    {
+        schedule.add(rate_hz);
+    }
+}
+
+void translator::set_bindings(const bindings::table* table)
+{
+    buttons = table;
+}
+
+void translator::set_mapping(const mapping::remap* remap)
+{
+    device_map = remap;
+}
+
+void translator::set_dead_zones(const xbox360_controller::dead_zones& zones)
+{
+    controller_state.calibration = zones;
+    controller_state.process_dead_zone();
+}
+
+void translator::set_screen(const std::vector<monitors::rect>* monitors,
+                            pointer_locator locate_pointer)
+{
+    screen = monitors;
+    this->locate_pointer = std::move(locate_pointer);
+}
+
+bool translator::handle_event(js_event& ev)
+{
+    JOY2MOUSE_TRACE_SCOPE_ARG("joystick_event", "number", ev.number);
+
+    if (!device_map->apply(ev))
+    {
+        return false;
+    }
+
+    // The initial state sent on open counts for axes, so resting offsets
+    // are seen from the start, but not for buttons held at that point.
+    switch (ev.type & ~JS_EVENT_INIT)
+    {
+        case JS_EVENT_BUTTON:
+        {
+            using xbox360_controller::button;
+
+            if (ev.type & JS_EVENT_INIT)
+            {
+                break;
+            }
+
+            auto updated_button = static_cast<button>(ev.number);
+            bool pressed = ev.value ? true : false;
+
+            // Releases go to the action the press went to, even if the
+            // bindings were switched in between.
+            auto& held = held_actions[ev.number];
+            if (pressed)
+            {
+                held = (*buttons)[ev.number];
+            }
+
+            switch (held.type)
+            {
+                case bindings::action_type::none:
+                    break;
+
+                case bindings::action_type::pointer_button:
+                    out.button(held.code, !pressed);
+                    break;
+
+                case bindings::action_type::key:
+                    out.key(held.code, !pressed, held.state);
+                    break;
+
+                case bindings::action_type::monitor_jump:
+                case bindings::action_type::region_jump:
+                    if (pressed)
+                    {
+                        jump_pointer(held);
+                    }
+                    break;
+
+                case bindings::action_type::absolute_pointer:
+                    set_absolute_pointer(pressed);
+                    break;
+            }
+
+            // stick buttons
+            if (updated_button == button::left_stick)
+            {
+                controller_state.left_stick_down = pressed;
+            }
+            else if (updated_button == button::right_stick)
+            {
+                controller_state.right_stick_down = pressed;
+            }
+
+            if (controller_state.left_stick_down &&
+                controller_state.right_stick_down)
+            {
+                out.key(XK_Escape, false);
+                out.key(XK_Escape, true);
+            }
+        } break;
+        case JS_EVENT_AXIS:
+        {
+            apply_axis_input(controller_state, ev);
+
+            // Kept corrected as it changes, so ticks and idle() only read
+            // it.
+            JOY2MOUSE_TRACE_SCOPE("process_dead_zone");
+            controller_state.process_dead_zone();
+        } break;
+    }
+
+    return true;
+}
+
+void translator::tick(clock_type::time_point now)
+{
+    auto due = schedule.run(now);
+    auto is_due = [due](output_channel c)
+    {
+        return (due & (1u << unsigned(c))) != 0;
+    };
+    auto rate_hz = [this](output_channel c)
+    {
+        return float(config.rates_hz[std::size_t(c)]);
+    };
+
+    const auto& corrected = controller_state.corrected;
+
+    if (is_due(output_channel::pointer))
+    {
+        // The two would fight over the pointer.
+        if (absolute_pointer)
+        {
+            update_absolute_pointer(corrected.right_stick);
+        }
+        else
+        {
+            auto hz = rate_hz(output_channel::pointer);
+            update_cursor(filter_cursor(corrected.left_stick, hz), hz);
+        }
+    }
+    if (is_due(output_channel::scroll) && !absolute_pointer)
+    {
+        update_scroll(corrected.right_stick, rate_hz(output_channel::scroll));
+    }
+    if (is_due(output_channel::volume))
+    {
+        update_volume(corrected.left_trigger, corrected.right_trigger,
+                      rate_hz(output_channel::volume));
+    }
+    if (is_due(output_channel::repeat))
+    {
+        update_dpad(now);
+    }
+}
+
+math::vec2f translator::filter_cursor(math::vec2f left_stick, float rate_hz)
+{
+    if (!config.filter_cursor)
+    {
+        return left_stick;
+    }
+
+    JOY2MOUSE_TRACE_SCOPE("filter_cursor");
+
+    const float dt = 1.0f / rate_hz;
+    math::vec2f filtered = { cursor_filter[0].filter(left_stick[0], dt),
+                             cursor_filter[1].filter(left_stick[1], dt) };
+
+    // Inside the dead zone the cursor stops at once rather than drifting on
+    // the filter's tail. The filter still sees the zeros, so flickering
+    // across the edge of the dead zone is smoothed too.
+    if (left_stick[0] == 0.0f && left_stick[1] == 0.0f)
+    {
+        return left_stick;
+    }
+    return filtered;
+}
+
+void translator::update_cursor(math::vec2f left_stick, float rate_hz)
+{
+    auto left_magnitude = left_stick.length();
+    if (left_magnitude)
+    {
+        left_magnitude = std::pow(left_magnitude, cursor_gamma);
+        left_stick = left_stick.normalized() * left_magnitude;
+
+        if (left_magnitude > cursor_accel_threshold)
+        {
+            channel.cursor_accel +=
+                left_magnitude * (cursor_accel_factor / rate_hz);
+            channel.cursor_accel =
+                std::min(channel.cursor_accel, max_cursor_accel);
+        }
+        else if (left_magnitude < cursor_reset_threshold)
+        {
+            channel.cursor_accel = 1.0f;
+        }
+
+        channel.cursor_accum +=
+            channel.cursor_accel * (cursor_speed / rate_hz) * left_stick;
+
+        if (std::abs(channel.cursor_accum[0]) >= 1.0f ||
+            std::abs(channel.cursor_accum[1]) >= 1.0f)
+        {
+            int dx = channel.cursor_accum[0];
+            int dy = channel.cursor_accum[1];
+
+            out.move_pointer(dx, dy);
+
+            channel.cursor_accum[0] -= dx;
+            channel.cursor_accum[1] -= dy;
+        }
+    }
+    else
+    {
+        channel.cursor_accel = 1.0f;
+    }
+}
+
+void translator::update_scroll(math::vec2f right_stick, float rate_hz)
+{
+    auto right_magnitude = right_stick.length();
+    if (right_magnitude)
+    {
+        right_magnitude = std::pow(right_magnitude, scroll_gamma);
+
+        if (right_magnitude > scroll_accel_threshold)
+        {
+            channel.scroll_accel +=
+                right_magnitude * (scroll_accel_factor / rate_hz);
+            channel.scroll_accel =
+                std::min(channel.scroll_accel, max_scroll_accel);
+        }
+        else if (right_magnitude < scroll_reset_threshold)
+        {
+            channel.scroll_accel = 1.0f;
+        }
+
+        auto delta = channel.scroll_accel * scroll_speed / rate_hz
+            * right_stick;
+
+        if (config.scroll == scroll_mode::smooth)
+        {
+            out.scroll(delta[0], delta[1]);
+            return;
+        }
+
+        channel.scroll_acum += delta;
+
+        // Scroll up
+        while (channel.scroll_acum[1] <= -1.0f)
+        {
+            out.button(Button4, true);
+            out.button(Button4, false);
+            channel.scroll_acum[1] += 1.0f;
+        }
+
+        // Scroll down
+        while (channel.scroll_acum[1] >= 1.0f)
+        {
+            out.button(Button5, true);
+            out.button(Button5, false);
+            channel.scroll_acum[1] -= 1.0f;
+        }
+
+        // Scroll left
+        while (channel.scroll_acum[0] <= -1.0f)
+        {
+            out.button(scroll_left_button, true);
+            out.button(scroll_left_button, false);
+            channel.scroll_acum[0] += 1.0f;
+        }
+
+        // Scroll right
+        while (channel.scroll_acum[0] >= 1.0f)
+        {
+            out.button(scroll_right_button, true);
+            out.button(scroll_right_button, false);
+            channel.scroll_acum[0] -= 1.0f;
+        }
+    }
+    else
+    {
+        channel.scroll_accel = 1.0f;
+        channel.scroll_acum = { 0.0f, 0.0f };
+    }
+}
+
+void translator::update_volume(float left_trigger, float right_trigger,
+                               float rate_hz)
+{
+    if (left_trigger)
+    {
+        left_trigger = std::pow(left_trigger, volume_down_gamma);
+
+        if (left_trigger > volume_down_accel_threshold)
+        {
+            channel.volume_down_accel +=
+                left_trigger * (volume_down_accel_factor / rate_hz);
+            channel.volume_down_accel =
+                std::min(channel.volume_down_accel, max_volume_down_accel);
+        }
+        else if (left_trigger < volume_down_reset_threshold)
+        {
+            channel.volume_down_accel = 1.0f;
+        }
+
+        channel.volume_acum -= channel.volume_down_accel * volume_down_speed
+            * left_trigger / rate_hz;
+    }
+    else
+    {
+        channel.volume_down_accel = 1.0f;
+    }
+
+    if (right_trigger)
+    {
+        right_trigger = std::pow(right_trigger, volume_up_gamma);
+
+        if (right_trigger > volume_up_accel_threshold)
+        {
+            channel.volume_up_accel +=
+                right_trigger * (volume_up_accel_factor / rate_hz);
+            channel.volume_up_accel =
+                std::min(channel.volume_up_accel, max_volume_up_accel);
+        }
+        else if (right_trigger < volume_up_reset_threshold)
+        {
+            channel.volume_up_accel = 1.0f;
+        }
+
+        channel.volume_acum += channel.volume_up_accel * volume_up_speed
+            * right_trigger / rate_hz;
+    }
+    else
+    {
+        channel.volume_up_accel = 1.0f;
+    }
+
+    if (!left_trigger && !right_trigger)
+    {
+        channel.volume_acum = 0;
+    }
+
+    // Volume down
+    while (channel.volume_acum <= -1.0f)
+    {
+        out.key(XF86XK_AudioLowerVolume, false);
+        out.key(XF86XK_AudioLowerVolume, true);
+        channel.volume_acum += 1.0f;
+    }
+
+    // Volume up
+    while (channel.volume_acum >= 1.0f)
+    {
+        out.key(XF86XK_AudioRaiseVolume, false);
+        out.key(XF86XK_AudioRaiseVolume, true);
+        channel.volume_acum -= 1.0f;
+    }
+}
+
+void translator::resume(clock_type::time_point now)
+{
+    schedule.resume(now);
+
+    // Nothing of the last activity carries over, whatever the filters and
+    // accumulators saw of the rest before ticking stopped.
+    cursor_filter[0].reset();
+    cursor_filter[1].reset();
+    channel.cursor_accel = 1.0f;
+    channel.cursor_accum = { 0.0f, 0.0f };
+    channel.scroll_accel = 1.0f;
+    channel.scroll_acum = { 0.0f, 0.0f };
+    channel.volume_down_accel = 1.0f;
+    channel.volume_up_accel = 1.0f;
+    channel.volume_acum = 0.0f;
+}
+
+bool translator::idle() const
+{
+    // Corrected values are relative to the rests, so released triggers are
+    // zero here whichever end of the axis they rest at.
+    const auto& corrected = controller_state.corrected;
+    const auto& dpad = controller_state.dpad;
+    return corrected.left_stick[0] == 0.0f && corrected.left_stick[1] == 0.0f
+        && corrected.right_stick[0] == 0.0f
+        && corrected.right_stick[1] == 0.0f
+        && corrected.left_trigger == 0.0f && corrected.right_trigger == 0.0f
+        && dpad[0] == 0.0f && dpad[1] == 0.0f
+        && old_dpad[0] == 0.0f && old_dpad[1] == 0.0f
+        && !absolute_pointer;
+}
+
+std::size_t translator::current_monitor() const
+{
+    int x;
+    int y;
+    if (locate_pointer && locate_pointer(x, y))
+    {
+        return monitors::find(*screen, x, y);
+    }
+    return 0;
+}
+
+void translator::jump_pointer(const bindings::action& jump)
+{
+    if (!screen || screen->empty())
+    {
+        return;
+    }
+
+    const auto& monitors = *screen;
+    auto index = current_monitor();
+
+    int column = 1;
+    int row = 1;
+    if (jump.type == bindings::action_type::monitor_jump)
+    {
+        index += jump.code == bindings::previous_monitor
+            ? monitors.size() - 1 : 1;
+        index %= monitors.size();
+    }
+    else
+    {
+        column = (jump.code - 1) % 3;
+        row = (jump.code - 1) / 3;
+    }
+
+    // Centers of the cells of a 3x3 grid; the middle one is the monitor's.
+    const auto& m = monitors[index];
+    out.warp_pointer(m.x + (2 * column + 1) * m.width / 6,
+                     m.y + (2 * row + 1) * m.height / 6);
+}
+
+void translator::set_absolute_pointer(bool enabled)
+{
+    if (enabled == absolute_pointer || (enabled && (!screen || screen->empty())))
+    {
+        return;
+    }
+
+    absolute_pointer = enabled;
+    if (absolute_pointer)
+    {
+        absolute_started = false;
+        absolute_monitor = current_monitor();
+        last_warp_x = INT_MIN;
+        last_warp_y = INT_MIN;
+    }
+    else
+    {
+        // Cursor and scrolling start over from where the sticks are now.
+        channel.cursor_accel = 1.0f;
+        channel.cursor_accum = { 0.0f, 0.0f };
+        cursor_filter[0].reset();
+        cursor_filter[1].reset();
+        channel.scroll_accel = 1.0f;
+        channel.scroll_acum = { 0.0f, 0.0f };
+    }
+}
+
+void translator::update_absolute_pointer(math::vec2f right_stick)
+{
+    if (!absolute_started)
+    {
+        if (right_stick[0] == 0.0f && right_stick[1] == 0.0f)
+        {
+            return;
+        }
+        absolute_started = true;
+    }
+
+    const auto& monitors = *screen;
+    const auto& m = monitors[std::min(absolute_monitor, monitors.size() - 1)];
+
+    // Stretches the round range of the stick onto the square, so the
+    // corners of the monitor can be reached too.
+    float x = right_stick[0];
+    float y = right_stick[1];
+    float edge = std::max(std::abs(x), std::abs(y));
+    if (edge > 0.0f)
+    {
+        float stretch = right_stick.length() / edge;
+        x = std::min(std::max(x * stretch, -1.0f), 1.0f);
+        y = std::min(std::max(y * stretch, -1.0f), 1.0f);
+    }
+
+    int warp_x = m.x + int(std::lround((x + 1.0f) / 2.0f * (m.width - 1)));
+    int warp_y = m.y + int(std::lround((y + 1.0f) / 2.0f * (m.height - 1)));
+    if (warp_x != last_warp_x || warp_y != last_warp_y)
+    {
+        out.warp_pointer(warp_x, warp_y);
+        last_warp_x = warp_x;
+        last_warp_y = warp_y;
+    }
+}
+
+void translator::update_dpad(clock_type::time_point now)
+{
+    using namespace std::chrono;
+
+    const auto key_repeat_time = milliseconds(250);
+    const auto key_repeat_interval = milliseconds(50);
+
+    auto dpad = controller_state.dpad;
+
+    if (dpad[0] != old_dpad[0])
+    {
+        if (old_dpad[0] > 0.5)
+        {
+            out.key(XK_Right, true);
+        }
+        else if (old_dpad[0] < -0.5)
+        {
+            out.key(XK_Left, true);
+        }
+
+        if (dpad[0] > 0.5)
+        {
+            out.key(XK_Right, false);
+        }
+        else if (dpad[0] < -0.5)
+        {
+            out.key(XK_Left, false);
+        }
+
+        last_dpad_x = now;
+        repeat_dpad_x = false;
+    }
+
+    if (dpad[1] != old_dpad[1])
+    {
+        if (old_dpad[1] > 0.5)
+        {
+            out.key(XK_Down, true);
+        }
+        else if (old_dpad[1] < -0.5)
+        {
+            out.key(XK_Up, true);
+        }
+
+        if (dpad[1] > 0.5)
+        {
+            out.key(XK_Down, false);
+        }
+        else if (dpad[1] < -0.5)
+        {
+            out.key(XK_Up, false);
+        }
+
+        last_dpad_y = now;
+        repeat_dpad_y = false;
+    }
+
+    if (!repeat_dpad_x && now - last_dpad_x >= key_repeat_time)
+    {
+        repeat_dpad_x = true;
+        last_dpad_x += key_repeat_time - key_repeat_interval;
+    }
+
+    if (repeat_dpad_x)
+    {
+        while (now - last_dpad_x >= key_repeat_interval)
+        {
+            if (dpad[0] > 0.5)
+            {
+                out.key(XK_Right, true);
+                out.key(XK_Right, false);
+            }
+            else if (dpad[0] < -0.5)
+            {
+                out.key(XK_Left, true);
+                out.key(XK_Left, false);
+            }
+
+            last_dpad_x += key_repeat_interval;
+        }
+    }
+
+    if (!repeat_dpad_y && now - last_dpad_y >= key_repeat_time)
+    {
+        repeat_dpad_y = true;
+        last_dpad_y += key_repeat_time - key_repeat_interval;
+    }
+
+    if (repeat_dpad_y)
+    {
+        while (now - last_dpad_y >= key_repeat_interval)
+        {
+            if (dpad[1] > 0.5)
+            {
+                out.key(XK_Down, true);
+                out.key(XK_Down, false);
+            }
+            else if (dpad[1] < -0.5)
+            {
+                out.key(XK_Up, true);
+                out.key(XK_Up, false);
+            }
+
+            last_dpad_y += key_repeat_interval;
+        }
+    }
+
+    old_dpad = dpad;
+}
+
+} // namespace pipeline
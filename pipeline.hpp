@@ -0,0 +1,194 @@
+#ifndef JOY2MOUSE_PIPELINE_HPP
+#define JOY2MOUSE_PIPELINE_HPP
+
+#include <linux/joystick.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "bindings.hpp"
+#include "filter.hpp"
+#include "mapping.hpp"
+#include "monitors.hpp"
+#include "output.hpp"
+#include "scheduler.hpp"
+#include "vec.hpp"
+#include "xbox360_controller.hpp"
+
+namespace pipeline {
+
+using clock_type = scheduler::clock_type;
+
+// Default update rates of the pointer and of the other channels.
+constexpr unsigned pointer_update_hz = 250;
+constexpr unsigned update_hz = 60;
+
+// The analog and repeating outputs, each updated at its own rate.
+enum class output_channel
+{
+    pointer,
+    scroll,
+    volume,
+
+    // D-pad keys and their auto-repeat.
+    repeat
+};
+
+constexpr std::size_t output_channel_count = 4;
+
+enum class scroll_mode
+{
+    // Whole notches as core pointer button clicks (4-7).
+    discrete,
+
+    // Fractional notches through output::sink::scroll, once per tick.
+    smooth
+};
+
+// Acceleration and sub-unit remainders of the analog output channels.
+struct channel_state
+{
+    float cursor_accel;
+    math::vec2f cursor_accum;
+    float scroll_accel;
+    math::vec2f scroll_acum;
+    float volume_down_accel;
+    float volume_up_accel;
+    float volume_acum;
+};
+
+struct settings
+{
+    scroll_mode scroll = scroll_mode::discrete;
+
+    // Updates per second of each output_channel.
+    std::array<unsigned, output_channel_count> rates_hz = {
+        { pointer_update_hz, update_hz, update_hz, update_hz } };
+
+    // Jitter filtering of the corrected left stick, per axis (x, y), before
+    // it drives the cursor. Off by default, since it adds latency.
+    bool filter_cursor = false;
+    std::array<filter::one_euro_parameters, 2> cursor_filter = {};
+};
+
+// Translates joystick events into pointer, button and key actions.
+//
+// Raw events only update the controller state (or emit button actions
+// immediately); everything analog is turned into actions by tick(), which
+// must be called at next_deadline(), when the channels that are due run.
+// Time is always passed in by the caller, so the same input produces the
+// same output whether it comes from a device or a recording.
+class translator
+{
+public:
+    translator(output::sink& out, clock_type::time_point start,
+               const settings& config = settings());
+
+    translator(const translator&) = delete;
+    translator& operator= (const translator&) = delete;
+    translator(translator&&) = default;
+
+    // Switches the button bindings. The table must outlive its use.
+    void set_bindings(const bindings::table* table);
+
+    // Sets how raw device events map to the Xbox 360 layout. The tables
+    // must outlive their use.
+    void set_mapping(const mapping::remap* remap);
+
+    void set_dead_zones(const xbox360_controller::dead_zones& zones);
+
+    // Returns the pointer position in root window coordinates, or false.
+    using pointer_locator = std::function<bool (int& x, int& y)>;
+
+    // Sets the monitors for absolute positioning and jumps, which do nothing
+    // without them. The vector must outlive its use; it is read, not copied,
+    // so it can be refreshed in place. The locator is only called when a
+    // mode starts or a jump is made, never per tick.
+    void set_screen(const std::vector<monitors::rect>* monitors,
+                    pointer_locator locate_pointer);
+
+    // Rewrites ev into the Xbox 360 layout and applies it. Returns false if
+    // the event maps to nothing.
+    bool handle_event(js_event& ev);
+    void tick(clock_type::time_point now);
+
+    clock_type::time_point next_deadline() const
+    {
+        return schedule.next_deadline();
+    }
+
+    // Channel updates skipped because tick() was called late.
+    std::uint64_t overruns() const
+    {
+        return schedule.overruns();
+    }
+
+    // True when the controller rests, so ticks would produce nothing until
+    // the next event. Callers may stop ticking until then and call resume()
+    // before the next tick, which starts the channels over as if they had
+    // never been active.
+    bool idle() const;
+    void resume(clock_type::time_point now);
+
+    const xbox360_controller::input_state& state() const
+    {
+        return controller_state;
+    }
+
+    const channel_state& channels() const
+    {
+        return channel;
+    }
+
+private:
+    math::vec2f filter_cursor(math::vec2f left_stick, float rate_hz);
+    void update_cursor(math::vec2f left_stick, float rate_hz);
+    void update_scroll(math::vec2f right_stick, float rate_hz);
+    void update_volume(float left_trigger, float right_trigger,
+                       float rate_hz);
+    void update_dpad(clock_type::time_point now);
+
+    std::size_t current_monitor() const;
+    void jump_pointer(const bindings::action& jump);
+    void set_absolute_pointer(bool enabled);
+    void update_absolute_pointer(math::vec2f right_stick);
+
+    output::sink& out;
+    settings config;
+
+    scheduler::schedule schedule;
+
+    xbox360_controller::input_state controller_state;
+
+    channel_state channel;
+    std::array<filter::one_euro, 2> cursor_filter;
+
+    math::vec2f old_dpad;
+    clock_type::time_point last_dpad_x;
+    clock_type::time_point last_dpad_y;
+    bool repeat_dpad_x;
+    bool repeat_dpad_y;
+
+    const std::vector<monitors::rect>* screen;
+    pointer_locator locate_pointer;
+
+    // While an absolute_pointer action is held, the right stick positions
+    // the pointer inside the monitor it was on. The pointer stays where it
+    // was until the stick first leaves its dead zone.
+    bool absolute_pointer;
+    bool absolute_started;
+    std::size_t absolute_monitor;
+    int last_warp_x;
+    int last_warp_y;
+
+    const mapping::remap* device_map;
+    const bindings::table* buttons;
+    bindings::table held_actions;
+};
+
+} // namespace pipeline
+
+#endif // !defined(JOY2MOUSE_PIPELINE_HPP)
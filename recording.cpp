@@ -0,0 +1,147 @@
+#include <errno.h>
+
+#include <cstring>
+
+#include "recording.hpp"
+
+namespace recording {
+
+namespace {
+
+const char magic[4] = { 'J', '2', 'M', 'R' };
+const std::uint32_t version = 1;
+
+// The mapping, calibration and configuration follow the header verbatim.
+// Their sizes are stored too, as is the size of the bindings tables in the
+// event stream, so a file written with another layout is rejected rather
+// than misread.
+struct header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t remap_size;
+    std::uint32_t zones_size;
+    std::uint32_t config_size;
+    std::uint32_t bindings_size;
+};
+
+} // namespace
+
+writer::writer()
+    : file(nullptr)
+{
+}
+
+writer::~writer()
+{
+    close();
+}
+
+bool writer::open(const char* path, const mapping::remap& device_map,
+                  const xbox360_controller::dead_zones& zones,
+                  const configuration& config)
+{
+    close();
+
+    file = std::fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    header h;
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.remap_size = sizeof(device_map);
+    h.zones_size = sizeof(zones);
+    h.config_size = sizeof(config);
+    h.bindings_size = sizeof(bindings::table);
+    return std::fwrite(&h, sizeof(h), 1, file) == 1
+        && std::fwrite(&device_map, sizeof(device_map), 1, file) == 1
+        && std::fwrite(&zones, sizeof(zones), 1, file) == 1
+        && std::fwrite(&config, sizeof(config), 1, file) == 1;
+}
+
+bool writer::write(std::uint64_t time_ns, const js_event& js)
+{
+    event ev = { time_ns, js };
+    return std::fwrite(&ev, sizeof(ev), 1, file) == 1;
+}
+
+bool writer::write_bindings(std::uint64_t time_ns,
+                            const bindings::table& buttons)
+{
+    event ev = { time_ns, { 0, 0, bindings_event, 0 } };
+    return std::fwrite(&ev, sizeof(ev), 1, file) == 1
+        && std::fwrite(&buttons, sizeof(buttons), 1, file) == 1;
+}
+
+bool writer::close()
+{
+    if (!file)
+    {
+        return true;
+    }
+
+    bool ok = !std::ferror(file);
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool load(const char* path, std::vector<event>& events,
+          std::vector<bindings::table>& tables, mapping::remap& device_map,
+          xbox360_controller::dead_zones& zones, configuration& config)
+{
+    std::FILE* file = std::fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    header h;
+    bool valid = std::fread(&h, sizeof(h), 1, file) == 1
+        && std::memcmp(h.magic, magic, sizeof(magic)) == 0
+        && h.version == version
+        && h.remap_size == sizeof(device_map)
+        && h.zones_size == sizeof(zones)
+        && h.config_size == sizeof(config)
+        && h.bindings_size == sizeof(bindings::table)
+        && std::fread(&device_map, sizeof(device_map), 1, file) == 1
+        && std::fread(&zones, sizeof(zones), 1, file) == 1
+        && std::fread(&config, sizeof(config), 1, file) == 1;
+
+    if (!valid)
+    {
+        std::fclose(file);
+        errno = EINVAL;
+        return false;
+    }
+
+    events.clear();
+    tables.clear();
+
+    event ev;
+    while (std::fread(&ev, sizeof(ev), 1, file) == 1)
+    {
+        if (ev.js.type == bindings_event)
+        {
+            bindings::table buttons;
+            if (std::fread(&buttons, sizeof(buttons), 1, file) != 1)
+            {
+                break;
+            }
+            ev.js.time = tables.size();
+            tables.push_back(buttons);
+        }
+        events.push_back(ev);
+    }
+
+    // A truncated trailing record is tolerated, since the daemon may have
+    // been killed mid-write.
+    bool ok = !std::ferror(file);
+    std::fclose(file);
+    return ok;
+}
+
+} // namespace recording
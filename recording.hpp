@@ -0,0 +1,99 @@
+#ifndef JOY2MOUSE_RECORDING_HPP
+#define JOY2MOUSE_RECORDING_HPP
+
+#include <linux/joystick.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+#include <vector>
+
+#include "bindings.hpp"
+#include "filter.hpp"
+#include "mapping.hpp"
+#include "pipeline.hpp"
+#include "xbox360_controller.hpp"
+
+namespace recording {
+
+// A raw joystick event with the time it was read, relative to the start of
+// the recording.
+//
+// Recordings are a small header with the device mapping, calibration and
+// configuration in effect, followed by these records verbatim, in native
+// byte order.
+struct event
+{
+    std::uint64_t time_ns;
+    js_event js;
+};
+
+static_assert(sizeof(event) == 16, "recorded events must stay compact");
+
+// js.type of the records marking a switch of the button bindings, a bit no
+// joystick sets. In the file the new table follows the record verbatim;
+// load() collects the tables separately and stores the index of each in
+// js.time of its record.
+constexpr std::uint8_t bindings_event = 0x40;
+
+static_assert(std::is_trivially_copyable<bindings::table>::value,
+              "button bindings are stored verbatim");
+
+// The options that shape what a recording replays to, stored in its
+// header so replays do not depend on the command line.
+struct configuration
+{
+    // The dead zones followed the resting noise and are estimated again
+    // from the same input on replay.
+    bool adaptive_calibration = false;
+
+    pipeline::scroll_mode scroll = pipeline::scroll_mode::discrete;
+
+    bool filter_cursor = false;
+    std::array<filter::one_euro_parameters, 2> cursor_filter = {};
+    std::array<unsigned, pipeline::output_channel_count> rates_hz =
+        pipeline::settings().rates_hz;
+};
+
+static_assert(std::is_trivially_copyable<configuration>::value,
+              "the configuration is stored verbatim");
+
+class writer
+{
+public:
+    writer();
+    ~writer();
+
+    writer(const writer&) = delete;
+    writer& operator= (const writer&) = delete;
+
+    bool open(const char* path, const mapping::remap& device_map,
+              const xbox360_controller::dead_zones& zones,
+              const configuration& config);
+    bool write(std::uint64_t time_ns, const js_event& js);
+
+    // Records that the translator switched to other button bindings.
+    bool write_bindings(std::uint64_t time_ns, const bindings::table& buttons);
+    bool close();
+
+    bool is_open() const
+    {
+        return file != nullptr;
+    }
+
+private:
+    std::FILE* file;
+};
+
+// Reads a complete recording, the button bindings it switched to and the
+// device mapping, calibration and configuration it was made with. Returns
+// false with errno set on I/O errors, or with errno set to EINVAL if the
+// file is not a valid recording.
+bool load(const char* path, std::vector<event>& events,
+          std::vector<bindings::table>& tables, mapping::remap& device_map,
+          xbox360_controller::dead_zones& zones, configuration& config);
+
+} // namespace recording
+
+#endif // !defined(JOY2MOUSE_RECORDING_HPP)
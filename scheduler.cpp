@@ -0,0 +1,86 @@
+#include <sys/timerfd.h>
+
+#include "scheduler.hpp"
+
+namespace scheduler {
+
+schedule::schedule(clock_type::time_point start)
+    : start(start), tasks(), missed(0)
+{
+}
+
+std::size_t schedule::add(unsigned rate_hz)
+{
+    auto period = std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::nanoseconds(1000000000 / rate_hz));
+    tasks.push_back({ period, start + period });
+    return tasks.size() - 1;
+}
+
+clock_type::time_point schedule::next_deadline() const
+{
+    auto deadline = clock_type::time_point::max();
+    for (const auto& task : tasks)
+    {
+        if (task.deadline < deadline)
+        {
+            deadline = task.deadline;
+        }
+    }
+    return deadline;
+}
+
+std::uint32_t schedule::run(clock_type::time_point now)
+{
+    std::uint32_t due = 0;
+    for (std::size_t i = 0; i < tasks.size(); ++i)
+    {
+        auto& task = tasks[i];
+        if (task.deadline > now)
+        {
+            continue;
+        }
+
+        auto periods = (now - task.deadline) / task.period + 1;
+        task.deadline += periods * task.period;
+        missed += periods - 1;
+        due |= 1u << i;
+    }
+    return due;
+}
+
+void schedule::resume(clock_type::time_point now)
+{
+    for (auto& task : tasks)
+    {
+        if (task.deadline <= now)
+        {
+            task.deadline += ((now - task.deadline) / task.period + 1)
+                * task.period;
+        }
+    }
+}
+
+bool arm(int timer_fd, clock_type::time_point deadline)
+{
+    auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        deadline.time_since_epoch()).count();
+
+    // An expiration time of zero would disarm the timer instead.
+    itimerspec ts = {};
+    ts.it_value.tv_sec = since_epoch / 1000000000;
+    ts.it_value.tv_nsec = since_epoch % 1000000000;
+    if (ts.it_value.tv_sec == 0 && ts.it_value.tv_nsec == 0)
+    {
+        ts.it_value.tv_nsec = 1;
+    }
+    return timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &ts, nullptr) == 0;
+}
+
+bool disarm(int timer_fd)
+{
+    itimerspec ts = {};
+    return timerfd_settime(timer_fd, 0, &ts, nullptr) == 0;
+}
+
+} // namespace scheduler
@@ -0,0 +1,69 @@
+#ifndef JOY2MOUSE_SCHEDULER_HPP
+#define JOY2MOUSE_SCHEDULER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace scheduler {
+
+using clock_type = std::chrono::steady_clock;
+
+// Runs periodic tasks of different rates from a single timer.
+//
+// Every task keeps its own deadline on a fixed grid of its period from the
+// start time, and the timer only has to be armed for the earliest of them.
+// A task that fell behind runs once and skips the periods it missed.
+class schedule
+{
+public:
+    explicit schedule(clock_type::time_point start);
+
+    // Adds a task running rate_hz times per second and returns its index,
+    // which is also its bit in the masks returned by run().
+    std::size_t add(unsigned rate_hz);
+
+    clock_type::duration period(std::size_t task) const
+    {
+        return tasks[task].period;
+    }
+
+    // The earliest deadline of all tasks.
+    clock_type::time_point next_deadline() const;
+
+    // Advances every task due at now past now and returns the mask of them.
+    std::uint32_t run(clock_type::time_point now);
+
+    // Moves deadlines that passed while the timer was deliberately not armed
+    // to their next period after now, without counting overruns.
+    void resume(clock_type::time_point now);
+
+    // Periods skipped by tasks that were run late.
+    std::uint64_t overruns() const
+    {
+        return missed;
+    }
+
+private:
+    struct task
+    {
+        clock_type::duration period;
+        clock_type::time_point deadline;
+    };
+
+    clock_type::time_point start;
+    std::vector<task> tasks;
+    std::uint64_t missed;
+};
+
+// Arms a CLOCK_MONOTONIC timerfd to expire once at deadline. Returns false
+// with errno set on failure.
+bool arm(int timer_fd, clock_type::time_point deadline);
+
+// Stops a timerfd. Returns false with errno set on failure.
+bool disarm(int timer_fd);
+
+} // namespace scheduler
+
+#endif // !defined(JOY2MOUSE_SCHEDULER_HPP)
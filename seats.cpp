@@ -0,0 +1,86 @@
+#include <boost/algorithm/string.hpp>
+#include <boost/format.hpp>
+
+#include <fstream>
+#include <iostream>
+
+#include "seats.hpp"
+
+namespace seats {
+
+bool load(const std::string& path, std::vector<seat>& result)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << boost::str(boost::format("%1%: cannot open seat table\n")
+                % path);
+        return false;
+    }
+
+    auto error = [&](int line, const std::string& message)
+    {
+        std::cerr << boost::str(boost::format("%1%:%2%: %3%\n")
+                % path % line % message);
+        return false;
+    };
+
+    std::vector<seat> loaded;
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); ++line_number)
+    {
+        boost::trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        boost::split(fields, line, boost::is_space(),
+                     boost::token_compress_on);
+        if (fields.size() != 3)
+        {
+            return error(line_number, "expected 'name device output'");
+        }
+
+        seat added;
+        added.name = fields[0];
+        added.device = fields[1];
+        if (fields[2] == "uinput")
+        {
+            added.output = output_kind::uinput;
+        }
+        else
+        {
+            added.output = output_kind::x11;
+            added.display = fields[2];
+        }
+
+        for (const auto& other : loaded)
+        {
+            if (other.name == added.name)
+            {
+                return error(line_number,
+                             "duplicate seat '" + added.name + "'");
+            }
+            if (other.device == added.device)
+            {
+                return error(line_number,
+                             "device '" + added.device + "' already used");
+            }
+        }
+
+        loaded.push_back(added);
+    }
+
+    if (loaded.empty())
+    {
+        std::cerr << boost::str(boost::format("%1%: no seats\n") % path);
+        return false;
+    }
+
+    result = std::move(loaded);
+    return true;
+}
+
+} // namespace seats
@@ -0,0 +1,45 @@
+#ifndef JOY2MOUSE_SEATS_HPP
+#define JOY2MOUSE_SEATS_HPP
+
+#include <string>
+#include <vector>
+
+namespace seats {
+
+enum class output_kind
+{
+    // Synthesized events on an X display.
+    x11,
+
+    // A virtual uinput mouse and keyboard.
+    uinput
+};
+
+// A controller and where its actions go.
+struct seat
+{
+    std::string name = {};
+
+    // Joystick device, for example /dev/input/js1.
+    std::string device = {};
+
+    output_kind output = output_kind::x11;
+
+    // X display name for x11 outputs, for example :1.
+    std::string display = {};
+};
+
+// Reads a seat table with one seat per line:
+//
+//     # name   device            output
+//     front    /dev/input/js0    :0
+//     lobby    /dev/input/js1    :1
+//     booth    /dev/input/js2    uinput
+//
+// The output is an X display name or "uinput". Lines starting with # are
+// comments. Errors are reported on std::cerr.
+bool load(const std::string& path, std::vector<seat>& result);
+
+} // namespace seats
+
+#endif // !defined(JOY2MOUSE_SEATS_HPP)
@@ -0,0 +1,155 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <new>
+
+#include "pipeline.hpp"
+#include "state_export.hpp"
+#include "trace.hpp"
+
+namespace state_export {
+
+namespace {
+
+void copy(math::vec2f from, float (&to)[2])
+{
+    to[0] = from[0];
+    to[1] = from[1];
+}
+
+void copy(const xbox360_controller::analog_state& from, analog& to)
+{
+    copy(from.left_stick, to.left_stick);
+    copy(from.right_stick, to.right_stick);
+    to.left_trigger = from.left_trigger;
+    to.right_trigger = from.right_trigger;
+}
+
+void copy(const pipeline::channel_state& from, channels& to)
+{
+    to.cursor_accel = from.cursor_accel;
+    copy(from.cursor_accum, to.cursor_accum);
+    to.scroll_accel = from.scroll_accel;
+    copy(from.scroll_acum, to.scroll_accum);
+    to.volume_down_accel = from.volume_down_accel;
+    to.volume_up_accel = from.volume_up_accel;
+    to.volume_accum = from.volume_acum;
+}
+
+} // namespace
+
+std::string default_name(const std::string& control_path)
+{
+    auto slash = control_path.rfind('/');
+    auto stem = control_path.substr(slash == std::string::npos ? 0 : slash + 1);
+    if (stem.size() > 5 && stem.compare(stem.size() - 5, 5, ".sock") == 0)
+    {
+        stem.resize(stem.size() - 5);
+    }
+    return "/joy2mouse-state-" + std::to_string(getuid()) + "-" + stem;
+}
+
+publisher::publisher()
+    : name(), fd(-1), shared(nullptr)
+{
+}
+
+publisher::~publisher()
+{
+    if (shared)
+    {
+        munmap(shared, sizeof(page));
+        shm_unlink(name.c_str());
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool publisher::open(const std::string& name)
+{
+    // The object is only reset once the lock shows that no other instance
+    // is publishing in it.
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    auto fail = [this](int error)
+    {
+        close(fd);
+        fd = -1;
+        errno = error;
+        return false;
+    };
+
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0)
+    {
+        return fail(errno == EWOULDBLOCK ? EBUSY : errno);
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) < 0)
+    {
+        return fail(errno);
+    }
+    if (status.st_uid != geteuid())
+    {
+        return fail(EACCES);
+    }
+
+    if (fchmod(fd, 0600) < 0 || ftruncate(fd, 0) < 0 ||
+        ftruncate(fd, sizeof(page)) < 0)
+    {
+        return fail(errno);
+    }
+
+    void* memory = mmap(nullptr, sizeof(page), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED)
+    {
+        return fail(errno);
+    }
+
+    // The object is zero filled; the header is written last so readers
+    // never accept a half initialized page.
+    shared = new (memory) page();
+    shared->snapshot_size = sizeof(snapshot);
+    shared->version = version;
+    std::atomic_thread_fence(std::memory_order_release);
+    shared->magic = magic;
+
+    this->name = name;
+    return true;
+}
+
+void publisher::publish(const pipeline::translator& translator,
+                        const counters& daemon, const std::string& profile)
+{
+    JOY2MOUSE_TRACE_SCOPE("publish_state");
+
+    auto& state = translator.state();
+
+    std::uint32_t sequence = shared->sequence.load(std::memory_order_relaxed);
+    shared->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto& data = shared->data;
+    copy(state.uncorrected, data.uncorrected);
+    copy(state.corrected, data.corrected);
+    copy(state.dpad, data.dpad);
+    copy(translator.channels(), data.channels);
+    data.daemon = daemon;
+    std::strncpy(data.profile, profile.c_str(), sizeof(data.profile) - 1);
+    data.profile[sizeof(data.profile) - 1] = '\0';
+
+    shared->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+} // namespace state_export
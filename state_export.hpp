@@ -0,0 +1,148 @@
+#ifndef JOY2MOUSE_STATE_EXPORT_HPP
+#define JOY2MOUSE_STATE_EXPORT_HPP
+
+// Live daemon state published in a POSIX shared memory page.
+//
+// The daemon rewrites the snapshot once per tick under a seqlock, so readers
+// map the page read-only and copy consistent snapshots without any syscall
+// or lock on either side. This header is all a reader needs.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace pipeline {
+class translator;
+} // namespace pipeline
+
+namespace state_export {
+
+// Name of the object published by the instance listening on the control
+// socket at control_path: "/joy2mouse-state-UID-STEM", with STEM the file
+// name of the socket without ".sock".
+std::string default_name(const std::string& control_path);
+
+constexpr std::uint32_t magic = 0x4a324d53; // "J2MS"
+constexpr std::uint32_t version = 1;
+
+struct counters
+{
+    std::uint64_t events;
+    std::uint64_t ticks;
+    std::uint64_t tick_overruns;
+    std::uint64_t profile_switches;
+};
+
+// Sticks and triggers, raw or after the dead zone correction. Stick
+// coordinates are x, y.
+struct analog
+{
+    float left_stick[2];
+    float right_stick[2];
+    float left_trigger;
+    float right_trigger;
+};
+
+// Acceleration and accumulated motion of the output channels.
+struct channels
+{
+    float cursor_accel;
+    float cursor_accum[2];
+    float scroll_accel;
+    float scroll_accum[2];
+    float volume_down_accel;
+    float volume_up_accel;
+    float volume_accum;
+};
+
+struct snapshot
+{
+    analog uncorrected;
+    analog corrected;
+    float dpad[2];
+    state_export::channels channels;
+    counters daemon;
+    char profile[32];
+};
+
+struct page
+{
+    // Checked by readers before anything else. Any layout change bumps
+    // version.
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t snapshot_size;
+
+    // Odd while the snapshot is being written.
+    std::atomic<std::uint32_t> sequence;
+
+    snapshot data;
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,
+              "the sequence must be usable across processes");
+
+constexpr unsigned read_attempts = 1000;
+
+// Copies a consistent snapshot out of a mapped page, retrying while the
+// daemon is writing. Returns false if the page has an unknown layout, or if
+// no attempt found it unchanged, for example because the daemon died
+// halfway through a write.
+inline bool read(const page& source, snapshot& result)
+{
+    if (source.magic != magic || source.version != version ||
+        source.snapshot_size != sizeof(snapshot))
+    {
+        return false;
+    }
+
+    for (unsigned attempt = 0; attempt < read_attempts; ++attempt)
+    {
+        std::uint32_t before = source.sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+
+        std::memcpy(&result, &source.data, sizeof(result));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (source.sequence.load(std::memory_order_relaxed) == before)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The writing side, owned by the daemon.
+class publisher
+{
+public:
+    publisher();
+    ~publisher();
+
+    publisher(const publisher&) = delete;
+    publisher& operator= (const publisher&) = delete;
+
+    // Creates and maps the shared memory object, readable by the user only.
+    // An object left behind by an instance that is gone is taken over, one
+    // still in use fails with EBUSY. Returns false with errno set on
+    // failure.
+    bool open(const std::string& name);
+
+    void publish(const pipeline::translator& translator,
+                 const counters& daemon, const std::string& profile);
+
+private:
+    std::string name;
+
+    // Kept open and locked for as long as the object is published.
+    int fd;
+    page* shared;
+};
+
+} // namespace state_export
+
+#endif // !defined(JOY2MOUSE_STATE_EXPORT_HPP)
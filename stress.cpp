@@ -0,0 +1,468 @@
+// Stress benchmark for the translation pipeline.
+//
+// A generator thread writes synthetic controller streams into pipes that
+// stand in for joystick devices, and the main thread services them with the
+// same epoll, timerfd and pipeline::translator structure as the daemon.
+// Each combination of device count and polling rate is run for a fixed
+// duration, and the sustained event rate, dropped events, tick overruns,
+// delivery latency and CPU time per event are reported.
+
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/joystick.h>
+#include <X11/Xlib.h>
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "output.hpp"
+#include "pipeline.hpp"
+#include "scheduler.hpp"
+#include "x11_output.hpp"
+#include "xbox360_controller.hpp"
+
+using pipeline::clock_type;
+
+struct options
+{
+    std::vector<unsigned> device_counts = { 1, 4, 16 };
+    std::vector<unsigned> rates = { 1000, 4000 };
+    double duration = 5.0;
+    bool x11 = false;
+};
+
+struct result
+{
+    std::uint64_t dropped = 0;
+    std::uint64_t processed = 0;
+    std::uint64_t ticks = 0;
+    std::uint64_t tick_overruns = 0;
+    std::vector<std::uint32_t> latencies_us = {};
+    double seconds = 0;
+    double cpu_seconds = 0;
+};
+
+std::uint32_t now_us(clock_type::time_point origin)
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(clock_type::now() - origin).count();
+}
+
+// Produces the events one device sends during one polling interval: a
+// smoothed random walk on both sticks and triggers, and occasional storms of
+// button presses and releases.
+class synthetic_controller
+{
+public:
+    explicit synthetic_controller(unsigned seed)
+        : rng(seed), targets(), values(), buttons(0), storm(0)
+    {
+    }
+
+    void poll(std::uint32_t time_us, std::vector<js_event>& events)
+    {
+        std::uniform_int_distribution<int> axis_value(-32767, 32767);
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::uniform_int_distribution<int> any_button(0, 10);
+
+        // Axes 0-5 are the sticks and triggers; the d-pad axes stay put.
+        for (int axis = 0; axis < 6; ++axis)
+        {
+            if (percent(rng) < 2)
+            {
+                targets[axis] = axis_value(rng);
+            }
+
+            int value = values[axis] + (targets[axis] - values[axis]) / 16;
+            if (value != values[axis])
+            {
+                values[axis] = value;
+                events.push_back(make_event(time_us, JS_EVENT_AXIS, axis,
+                                            value));
+            }
+        }
+
+        if (!storm && percent(rng) == 0)
+        {
+            storm = 32;
+        }
+
+        if (storm)
+        {
+            --storm;
+
+            // Stick buttons are left out, pressing both sends Escape.
+            int button = any_button(rng);
+            if (button == int(xbox360_controller::button::left_stick))
+            {
+                button = int(xbox360_controller::button::face_a);
+            }
+
+            buttons ^= 1u << button;
+            bool pressed = buttons & (1u << button);
+            events.push_back(make_event(time_us, JS_EVENT_BUTTON, button,
+                                        pressed));
+        }
+    }
+
+private:
+    static js_event make_event(std::uint32_t time_us, std::uint8_t type,
+                               int number, int value)
+    {
+        js_event ev;
+        ev.time = time_us;
+        ev.value = value;
+        ev.type = type;
+        ev.number = number;
+        return ev;
+    }
+
+    std::mt19937 rng;
+    int targets[6];
+    int values[6];
+    unsigned buttons;
+    unsigned storm;
+};
+
+void generate(const std::vector<int>& write_fds, unsigned rate,
+              clock_type::time_point origin, clock_type::time_point end,
+              result& stats)
+{
+    std::vector<synthetic_controller> controllers;
+    for (std::size_t i = 0; i < write_fds.size(); ++i)
+    {
+        controllers.emplace_back(i + 1);
+    }
+
+    std::vector<js_event> events;
+    auto period = std::chrono::nanoseconds(1000000000 / rate);
+    auto next_poll = clock_type::now();
+
+    while (next_poll < end)
+    {
+        std::this_thread::sleep_until(next_poll);
+        next_poll += period;
+
+        for (std::size_t i = 0; i < write_fds.size(); ++i)
+        {
+            events.clear();
+            controllers[i].poll(now_us(origin), events);
+            if (events.empty())
+            {
+                continue;
+            }
+
+            // A full pipe means the daemon side has fallen behind.
+            ssize_t size = events.size() * sizeof(js_event);
+            if (write(write_fds[i], events.data(), size) != size)
+            {
+                stats.dropped += events.size();
+            }
+        }
+    }
+}
+
+bool run(unsigned device_count, unsigned rate, const options& opts,
+         output::sink& out, result& stats)
+{
+    using namespace std::chrono;
+
+    int epfd = epoll_create(device_count + 1);
+    if (epfd < 0)
+    {
+        perror("error opening epoll interface");
+        return false;
+    }
+
+    int tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (tfd < 0)
+    {
+        perror("error opening timer interface");
+        return false;
+    }
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = device_count;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &event) < 0)
+    {
+        perror("error adding timer to epoll");
+        return false;
+    }
+
+    std::vector<int> read_fds;
+    std::vector<int> write_fds;
+    for (unsigned i = 0; i < device_count; ++i)
+    {
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK) < 0)
+        {
+            perror("error creating device pipe");
+            return false;
+        }
+        read_fds.push_back(fds[0]);
+        write_fds.push_back(fds[1]);
+
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &event) < 0)
+        {
+            perror("error adding device to epoll");
+            return false;
+        }
+    }
+
+    auto origin = clock_type::now();
+    auto end = origin + duration_cast<clock_type::duration>(
+        duration<double>(opts.duration));
+
+    std::vector<std::unique_ptr<pipeline::translator>> translators;
+    for (unsigned i = 0; i < device_count; ++i)
+    {
+        translators.emplace_back(new pipeline::translator(out, origin));
+    }
+
+    // All translators share the start and rates, and so their deadlines.
+    if (!scheduler::arm(tfd, translators.front()->next_deadline()))
+    {
+        perror("error setting timer");
+        return false;
+    }
+
+    stats.latencies_us.reserve(std::size_t(device_count) * rate * 8
+                               * opts.duration);
+
+    rusage usage_before;
+    getrusage(RUSAGE_THREAD, &usage_before);
+
+    std::thread generator(generate, std::cref(write_fds), rate, origin, end,
+                          std::ref(stats));
+
+    while (clock_type::now() < end)
+    {
+        int status = epoll_wait(epfd, &event, 1, 100);
+        if (status < 1)
+        {
+            continue;
+        }
+
+        if (event.data.u32 < device_count)
+        {
+            js_event ev;
+            if (read(read_fds[event.data.u32], &ev, sizeof(ev)) != sizeof(ev))
+            {
+                continue;
+            }
+
+            translators[event.data.u32]->handle_event(ev);
+
+            ++stats.processed;
+            stats.latencies_us.push_back(now_us(origin) - ev.time);
+        }
+        else
+        {
+            std::uint64_t expirations;
+            if (read(tfd, &expirations, sizeof(expirations))
+                != sizeof(expirations))
+            {
+                continue;
+            }
+
+            auto now = clock_type::now();
+            for (auto& translator : translators)
+            {
+                translator->tick(now);
+            }
+
+            if (!scheduler::arm(tfd, translators.front()->next_deadline()))
+            {
+                perror("error setting timer");
+                break;
+            }
+
+            ++stats.ticks;
+            stats.tick_overruns = translators.front()->overruns();
+        }
+    }
+
+    rusage usage_after;
+    getrusage(RUSAGE_THREAD, &usage_after);
+
+    generator.join();
+
+    stats.seconds = duration<double>(clock_type::now() - origin).count();
+    auto cpu = [](const rusage& usage)
+    {
+        return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+            + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    };
+    stats.cpu_seconds = cpu(usage_after) - cpu(usage_before);
+
+    for (unsigned i = 0; i < device_count; ++i)
+    {
+        close(read_fds[i]);
+        close(write_fds[i]);
+    }
+    close(tfd);
+    close(epfd);
+
+    return true;
+}
+
+void print_result(unsigned device_count, unsigned rate, result& stats)
+{
+    auto& latencies = stats.latencies_us;
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) -> std::uint32_t
+    {
+        if (latencies.empty())
+        {
+            return 0;
+        }
+        return latencies[std::size_t(p * (latencies.size() - 1))];
+    };
+
+    double cpu_ns_per_event = stats.processed
+        ? stats.cpu_seconds * 1e9 / stats.processed : 0.0;
+
+    std::cout << boost::str(boost::format(
+        "%1$7u %2$7u %3$12.0f %4$9u %5$7u %6$8u %7$8u %8$8u %9$8u %10$10.0f\n")
+        % device_count % rate
+        % (stats.processed / stats.seconds) % stats.dropped
+        % stats.ticks % stats.tick_overruns
+        % percentile(0.5) % percentile(0.99) % percentile(1.0)
+        % cpu_ns_per_event);
+}
+
+bool parse_list(const char* text, std::vector<unsigned>& values)
+{
+    values.clear();
+
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        char* end;
+        unsigned long value = std::strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end || value == 0)
+        {
+            return false;
+        }
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+bool parse_options(int argc, char** argv, options& opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--devices") == 0 && i + 1 < argc)
+        {
+            if (!parse_list(argv[++i], opts.device_counts))
+            {
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+        {
+            if (!parse_list(argv[++i], opts.rates))
+            {
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+        {
+            opts.duration = std::atof(argv[++i]);
+            if (opts.duration <= 0)
+            {
+                return false;
+            }
+        }
+        else if (std::strcmp(argv[i], "--x11") == 0)
+        {
+            opts.x11 = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    options opts;
+    if (!parse_options(argc, argv, opts))
+    {
+        std::cerr << boost::str(boost::format(
+            "usage: %1% [--devices N,...] [--rate HZ,...] [--duration SECONDS]"
+            " [--x11]\n"
+            "\n"
+            "  --devices N,...  device counts to run (default 1,4,16)\n"
+            "  --rate HZ,...    per-device polling rates (default 1000,4000)\n"
+            "  --duration S     seconds per run (default 5)\n"
+            "  --x11            send actions to the X display, e.g. Xvfb,\n"
+            "                   instead of discarding them\n")
+            % argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Display* dpy = nullptr;
+    std::unique_ptr<output::sink> out(new output::null_sink());
+    if (opts.x11)
+    {
+        dpy = XOpenDisplay(nullptr);
+        if (dpy == None)
+        {
+            perror("error opening display");
+            return EXIT_FAILURE;
+        }
+        out.reset(new output::x11_sink(dpy));
+    }
+
+    std::cout << "devices    rate     events/s   dropped   ticks overruns"
+                 "  p50 (us)  p99 (us)  max (us)  cpu ns/ev\n";
+
+    for (unsigned device_count : opts.device_counts)
+    {
+        for (unsigned rate : opts.rates)
+        {
+            result stats;
+            if (!run(device_count, rate, opts, *out, stats))
+            {
+                return EXIT_FAILURE;
+            }
+            print_result(device_count, rate, stats);
+        }
+    }
+
+    if (dpy)
+    {
+        out.reset();
+        XCloseDisplay(dpy);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include "trace.hpp"
+
+#if defined(JOY2MOUSE_TRACE)
+
+#include <unistd.h>
+
+#include <array>
+#include <cstdio>
+
+namespace trace {
+
+namespace {
+
+std::array<span, buffer_capacity> spans;
+std::size_t next_span = 0;
+bool wrapped = false;
+
+void write_span(std::FILE* out, const span& s, std::uint64_t origin_ns,
+                int pid, bool first)
+{
+    // Chrome trace timestamps are in microseconds.
+    std::fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":1,"
+                 "\"ts\":%.3f,\"dur\":%.3f",
+                 first ? "" : ",", s.name, pid,
+                 (s.begin_ns - origin_ns) / 1000.0,
+                 (s.end_ns - s.begin_ns) / 1000.0);
+    if (s.arg_name)
+    {
+        std::fprintf(out, ",\"args\":{\"%s\":%lld}", s.arg_name,
+                     static_cast<long long>(s.arg));
+    }
+    std::fputs("}", out);
+}
+
+} // namespace
+
+void record(const span& s)
+{
+    spans[next_span] = s;
+    if (++next_span == spans.size())
+    {
+        next_span = 0;
+        wrapped = true;
+    }
+}
+
+bool write_chrome_json(const char* path)
+{
+    std::FILE* out = std::fopen(path, "w");
+    if (!out)
+    {
+        return false;
+    }
+
+    std::size_t first = wrapped ? next_span : 0;
+    std::size_t count = wrapped ? spans.size() : next_span;
+    // Spans are recorded when they end, so an enclosing span can start
+    // before the oldest recorded one.
+    std::uint64_t origin_ns = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const span& s = spans[(first + i) % spans.size()];
+        if (i == 0 || s.begin_ns < origin_ns)
+        {
+            origin_ns = s.begin_ns;
+        }
+    }
+    int pid = getpid();
+
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const span& s = spans[(first + i) % spans.size()];
+        write_span(out, s, origin_ns, pid, i == 0);
+    }
+    std::fputs("\n]}\n", out);
+
+    bool ok = !std::ferror(out);
+    return std::fclose(out) == 0 && ok;
+}
+
+} // namespace trace
+
+#endif // defined(JOY2MOUSE_TRACE)
@@ -0,0 +1,86 @@
+#ifndef JOY2MOUSE_TRACE_HPP
+#define JOY2MOUSE_TRACE_HPP
+
+// Scoped trace spans recorded into a preallocated ring buffer and exported
+// as Chrome trace-event JSON (loadable in chrome://tracing and Perfetto).
+//
+// Spans only exist when built with JOY2MOUSE_TRACE defined; otherwise the
+// macros below expand to nothing and no trace code is compiled in.
+
+#if defined(JOY2MOUSE_TRACE)
+
+#include <cstddef>
+#include <cstdint>
+#include <time.h>
+
+namespace trace {
+
+constexpr std::size_t buffer_capacity = 1 << 16;
+
+struct span
+{
+    const char* name;
+    const char* arg_name;
+    std::int64_t arg;
+    std::uint64_t begin_ns;
+    std::uint64_t end_ns;
+};
+
+inline std::uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return std::uint64_t(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
+
+void record(const span& s);
+
+// Writes the buffered spans, oldest first, to path. Returns false on I/O
+// errors.
+bool write_chrome_json(const char* path);
+
+class scoped_span
+{
+public:
+    explicit scoped_span(const char* name, const char* arg_name = nullptr,
+                         std::int64_t arg = 0)
+        : s{name, arg_name, arg, now_ns(), 0}
+    {
+    }
+
+    ~scoped_span()
+    {
+        s.end_ns = now_ns();
+        record(s);
+    }
+
+    scoped_span(const scoped_span&) = delete;
+    scoped_span& operator= (const scoped_span&) = delete;
+
+private:
+    span s;
+};
+
+} // namespace trace
+
+#define JOY2MOUSE_TRACE_CAT_(a, b) a##b
+#define JOY2MOUSE_TRACE_CAT(a, b) JOY2MOUSE_TRACE_CAT_(a, b)
+
+#define JOY2MOUSE_TRACE_SCOPE(name) \
+    ::trace::scoped_span JOY2MOUSE_TRACE_CAT(trace_span_, __LINE__)(name)
+#define JOY2MOUSE_TRACE_SCOPE_ARG(name, arg_name, arg) \
+    ::trace::scoped_span JOY2MOUSE_TRACE_CAT(trace_span_, __LINE__)( \
+        name, arg_name, arg)
+#define JOY2MOUSE_TRACE_WRITE(path) ::trace::write_chrome_json(path)
+
+#else
+
+#define JOY2MOUSE_TRACE_SCOPE(name) do {} while (false)
+// The argument stays unevaluated, but still counts as used.
+#define JOY2MOUSE_TRACE_SCOPE_ARG(name, arg_name, arg) \
+    do { static_cast<void>(sizeof(arg)); } while (false)
+#define JOY2MOUSE_TRACE_WRITE(path) true
+
+#endif // defined(JOY2MOUSE_TRACE)
+
+#endif // !defined(JOY2MOUSE_TRACE_HPP)
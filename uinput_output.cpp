@@ -0,0 +1,401 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/XF86keysym.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "trace.hpp"
+#include "uinput_output.hpp"
+
+namespace output {
+
+namespace {
+
+constexpr int units_per_notch = 120;
+
+void set_event(input_event& ev, unsigned short type, unsigned short code,
+               int value)
+{
+    std::memset(&ev, 0, sizeof(ev));
+    ev.type = type;
+    ev.code = code;
+    ev.value = value;
+}
+
+// Adds the hi-res and, once whole notches have accumulated, the legacy
+// wheel events for a scroll by fractional notches. Returns the number of
+// events written, at most 4.
+int add_wheel_events(float horizontal, float vertical, float remainder[2],
+                     int pending_notch_units[2], input_event* events)
+{
+    // Wheel axes count up and to the right, so vertical is flipped.
+    const float deltas[2] = { horizontal, -vertical };
+    const unsigned short hi_res_codes[2] = { REL_HWHEEL_HI_RES,
+                                             REL_WHEEL_HI_RES };
+    const unsigned short notch_codes[2] = { REL_HWHEEL, REL_WHEEL };
+
+    int count = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        remainder[i] += deltas[i] * units_per_notch;
+        int units = static_cast<int>(remainder[i]);
+        if (!units)
+        {
+            continue;
+        }
+        remainder[i] -= units;
+
+        set_event(events[count++], EV_REL, hi_res_codes[i], units);
+
+        pending_notch_units[i] += units;
+        int notches = pending_notch_units[i] / units_per_notch;
+        if (notches)
+        {
+            pending_notch_units[i] -= notches * units_per_notch;
+            set_event(events[count++], EV_REL, notch_codes[i], notches);
+        }
+    }
+    return count;
+}
+
+struct key_code
+{
+    unsigned keysym;
+    unsigned short code;
+};
+
+const key_code key_codes[] = {
+    { XK_a, KEY_A }, { XK_b, KEY_B }, { XK_c, KEY_C }, { XK_d, KEY_D },
+    { XK_e, KEY_E }, { XK_f, KEY_F }, { XK_g, KEY_G }, { XK_h, KEY_H },
+    { XK_i, KEY_I }, { XK_j, KEY_J }, { XK_k, KEY_K }, { XK_l, KEY_L },
+    { XK_m, KEY_M }, { XK_n, KEY_N }, { XK_o, KEY_O }, { XK_p, KEY_P },
+    { XK_q, KEY_Q }, { XK_r, KEY_R }, { XK_s, KEY_S }, { XK_t, KEY_T },
+    { XK_u, KEY_U }, { XK_v, KEY_V }, { XK_w, KEY_W }, { XK_x, KEY_X },
+    { XK_y, KEY_Y }, { XK_z, KEY_Z },
+    { XK_0, KEY_0 }, { XK_1, KEY_1 }, { XK_2, KEY_2 }, { XK_3, KEY_3 },
+    { XK_4, KEY_4 }, { XK_5, KEY_5 }, { XK_6, KEY_6 }, { XK_7, KEY_7 },
+    { XK_8, KEY_8 }, { XK_9, KEY_9 },
+    { XK_F1, KEY_F1 }, { XK_F2, KEY_F2 }, { XK_F3, KEY_F3 },
+    { XK_F4, KEY_F4 }, { XK_F5, KEY_F5 }, { XK_F6, KEY_F6 },
+    { XK_F7, KEY_F7 }, { XK_F8, KEY_F8 }, { XK_F9, KEY_F9 },
+    { XK_F10, KEY_F10 }, { XK_F11, KEY_F11 }, { XK_F12, KEY_F12 },
+    { XK_Escape, KEY_ESC }, { XK_Return, KEY_ENTER }, { XK_space, KEY_SPACE },
+    { XK_Tab, KEY_TAB }, { XK_BackSpace, KEY_BACKSPACE },
+    { XK_Delete, KEY_DELETE }, { XK_Insert, KEY_INSERT },
+    { XK_Home, KEY_HOME }, { XK_End, KEY_END },
+    { XK_Prior, KEY_PAGEUP }, { XK_Next, KEY_PAGEDOWN },
+    { XK_Left, KEY_LEFT }, { XK_Right, KEY_RIGHT },
+    { XK_Up, KEY_UP }, { XK_Down, KEY_DOWN },
+    { XF86XK_Back, KEY_BACK }, { XF86XK_Forward, KEY_FORWARD },
+    { XF86XK_AudioMute, KEY_MUTE },
+    { XF86XK_AudioLowerVolume, KEY_VOLUMEDOWN },
+    { XF86XK_AudioRaiseVolume, KEY_VOLUMEUP },
+    { XF86XK_AudioPlay, KEY_PLAYPAUSE }, { XF86XK_AudioStop, KEY_STOPCD },
+    { XF86XK_AudioPrev, KEY_PREVIOUSSONG },
+    { XF86XK_AudioNext, KEY_NEXTSONG },
+};
+
+struct modifier_code
+{
+    unsigned mask;
+    unsigned short code;
+};
+
+const modifier_code modifier_codes[] = {
+    { ShiftMask, KEY_LEFTSHIFT }, { ControlMask, KEY_LEFTCTRL },
+    { Mod1Mask, KEY_LEFTALT }, { Mod4Mask, KEY_LEFTMETA },
+};
+
+// Returns the key for a keysym, or 0. Letters match in either case.
+unsigned short key_for(unsigned keysym)
+{
+    if (keysym >= XK_A && keysym <= XK_Z)
+    {
+        keysym += XK_a - XK_A;
+    }
+    for (const auto& entry : key_codes)
+    {
+        if (entry.keysym == keysym)
+        {
+            return entry.code;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+uinput_scroll_sink::uinput_scroll_sink(sink& fallback)
+    : fallback(fallback), fd(-1), remainder{ 0.0f, 0.0f },
+      pending_notch_units{ 0, 0 }
+{
+}
+
+uinput_scroll_sink::~uinput_scroll_sink()
+{
+    if (fd >= 0)
+    {
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+    }
+}
+
+bool uinput_scroll_sink::open(const char* path)
+{
+    fd = ::open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    // libinput only treats devices with pointer buttons and motion as mice,
+    // so those are advertised even though they are never sent.
+    bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0
+        && ioctl(fd, UI_SET_KEYBIT, BTN_LEFT) == 0
+        && ioctl(fd, UI_SET_EVBIT, EV_REL) == 0
+        && ioctl(fd, UI_SET_RELBIT, REL_X) == 0
+        && ioctl(fd, UI_SET_RELBIT, REL_Y) == 0
+        && ioctl(fd, UI_SET_RELBIT, REL_WHEEL) == 0
+        && ioctl(fd, UI_SET_RELBIT, REL_HWHEEL) == 0
+        && ioctl(fd, UI_SET_RELBIT, REL_WHEEL_HI_RES) == 0
+        && ioctl(fd, UI_SET_RELBIT, REL_HWHEEL_HI_RES) == 0;
+
+    uinput_setup setup;
+    std::memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    std::strncpy(setup.name, "joy2mouse scroll", UINPUT_MAX_NAME_SIZE - 1);
+
+    ok = ok && ioctl(fd, UI_DEV_SETUP, &setup) == 0
+        && ioctl(fd, UI_DEV_CREATE) == 0;
+    if (!ok)
+    {
+        int error = errno;
+        close(fd);
+        fd = -1;
+        errno = error;
+    }
+    return ok;
+}
+
+void uinput_scroll_sink::move_pointer(int dx, int dy)
+{
+    fallback.move_pointer(dx, dy);
+}
+
+void uinput_scroll_sink::warp_pointer(int x, int y)
+{
+    fallback.warp_pointer(x, y);
+}
+
+void uinput_scroll_sink::button(unsigned button, bool release)
+{
+    fallback.button(button, release);
+}
+
+void uinput_scroll_sink::key(unsigned keysym, bool release, unsigned state)
+{
+    fallback.key(keysym, release, state);
+}
+
+void uinput_scroll_sink::scroll(float horizontal, float vertical)
+{
+    JOY2MOUSE_TRACE_SCOPE("uinput_scroll");
+
+    input_event events[5];
+    int count = add_wheel_events(horizontal, vertical, remainder,
+                                 pending_notch_units, events);
+    if (!count)
+    {
+        return;
+    }
+
+    set_event(events[count++], EV_SYN, SYN_REPORT, 0);
+    if (write(fd, events, count * sizeof(input_event)) < 0)
+    {
+        perror("error writing scroll event");
+    }
+}
+
+uinput_sink::uinput_sink()
+    : fd(-1), remainder{ 0.0f, 0.0f }, pending_notch_units{ 0, 0 }
+{
+}
+
+uinput_sink::~uinput_sink()
+{
+    if (fd >= 0)
+    {
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+    }
+}
+
+bool uinput_sink::open(const std::string& name, const char* path)
+{
+    fd = ::open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0
+        && ioctl(fd, UI_SET_EVBIT, EV_REL) == 0;
+
+    for (int code : { BTN_LEFT, BTN_MIDDLE, BTN_RIGHT, BTN_SIDE, BTN_EXTRA })
+    {
+        ok = ok && ioctl(fd, UI_SET_KEYBIT, code) == 0;
+    }
+    for (const auto& entry : key_codes)
+    {
+        ok = ok && ioctl(fd, UI_SET_KEYBIT, entry.code) == 0;
+    }
+    for (const auto& entry : modifier_codes)
+    {
+        ok = ok && ioctl(fd, UI_SET_KEYBIT, entry.code) == 0;
+    }
+    for (int code : { REL_X, REL_Y, REL_WHEEL, REL_HWHEEL, REL_WHEEL_HI_RES,
+                      REL_HWHEEL_HI_RES })
+    {
+        ok = ok && ioctl(fd, UI_SET_RELBIT, code) == 0;
+    }
+
+    uinput_setup setup;
+    std::memset(&setup, 0, sizeof(setup));
+    setup.id.bustype = BUS_VIRTUAL;
+    std::strncpy(setup.name, ("joy2mouse " + name).c_str(),
+                 UINPUT_MAX_NAME_SIZE - 1);
+
+    ok = ok && ioctl(fd, UI_DEV_SETUP, &setup) == 0
+        && ioctl(fd, UI_DEV_CREATE) == 0;
+    if (!ok)
+    {
+        int error = errno;
+        close(fd);
+        fd = -1;
+        errno = error;
+    }
+    return ok;
+}
+
+void uinput_sink::move_pointer(int dx, int dy)
+{
+    JOY2MOUSE_TRACE_SCOPE("uinput_move");
+
+    input_event events[3];
+    set_event(events[0], EV_REL, REL_X, dx);
+    set_event(events[1], EV_REL, REL_Y, dy);
+    set_event(events[2], EV_SYN, SYN_REPORT, 0);
+    if (write(fd, events, sizeof(events)) < 0)
+    {
+        perror("error writing pointer event");
+    }
+}
+
+void uinput_sink::warp_pointer(int, int)
+{
+}
+
+void uinput_sink::button(unsigned button, bool release)
+{
+    // Wheel buttons click on press only, like the X server does.
+    if (button >= Button4 && button <= 7)
+    {
+        if (!release)
+        {
+            float horizontal = button == 6 ? -1.0f : button == 7 ? 1.0f : 0.0f;
+            float vertical = button == Button4 ? -1.0f
+                : button == Button5 ? 1.0f : 0.0f;
+            scroll(horizontal, vertical);
+        }
+        return;
+    }
+
+    unsigned short code;
+    switch (button)
+    {
+        case Button1: code = BTN_LEFT; break;
+        case Button2: code = BTN_MIDDLE; break;
+        case Button3: code = BTN_RIGHT; break;
+        case 8: code = BTN_SIDE; break;
+        case 9: code = BTN_EXTRA; break;
+        default: return;
+    }
+
+    input_event events[2];
+    set_event(events[0], EV_KEY, code, release ? 0 : 1);
+    set_event(events[1], EV_SYN, SYN_REPORT, 0);
+    if (write(fd, events, sizeof(events)) < 0)
+    {
+        perror("error writing button event");
+    }
+}
+
+void uinput_sink::key(unsigned keysym, bool release, unsigned state)
+{
+    JOY2MOUSE_TRACE_SCOPE("uinput_key");
+
+    unsigned short code = key_for(keysym);
+    if (!code)
+    {
+        return;
+    }
+
+    // Modifiers go down before the key and up after it.
+    input_event events[6];
+    int count = 0;
+    if (!release)
+    {
+        for (const auto& modifier : modifier_codes)
+        {
+            if (state & modifier.mask)
+            {
+                set_event(events[count++], EV_KEY, modifier.code, 1);
+            }
+        }
+    }
+    set_event(events[count++], EV_KEY, code, release ? 0 : 1);
+    if (release)
+    {
+        for (const auto& modifier : modifier_codes)
+        {
+            if (state & modifier.mask)
+            {
+                set_event(events[count++], EV_KEY, modifier.code, 0);
+            }
+        }
+    }
+    set_event(events[count++], EV_SYN, SYN_REPORT, 0);
+
+    if (write(fd, events, count * sizeof(input_event)) < 0)
+    {
+        perror("error writing key event");
+    }
+}
+
+void uinput_sink::scroll(float horizontal, float vertical)
+{
+    JOY2MOUSE_TRACE_SCOPE("uinput_scroll");
+
+    input_event events[5];
+    int count = add_wheel_events(horizontal, vertical, remainder,
+                                 pending_notch_units, events);
+    if (!count)
+    {
+        return;
+    }
+
+    set_event(events[count++], EV_SYN, SYN_REPORT, 0);
+    if (write(fd, events, count * sizeof(input_event)) < 0)
+    {
+        perror("error writing scroll event");
+    }
+}
+
+} // namespace output
@@ -0,0 +1,78 @@
+#ifndef JOY2MOUSE_UINPUT_OUTPUT_HPP
+#define JOY2MOUSE_UINPUT_OUTPUT_HPP
+
+#include <string>
+
+#include "output.hpp"
+
+namespace output {
+
+// Scrolls through a virtual uinput wheel device with high-resolution wheel
+// axes, and passes every other action on to another sink.
+//
+// Each scroll() call becomes one REL_WHEEL_HI_RES/REL_HWHEEL_HI_RES report
+// (120 units per notch), plus the legacy REL_WHEEL/REL_HWHEEL notches once
+// whole ones have accumulated, for clients without high-resolution support.
+class uinput_scroll_sink : public sink
+{
+public:
+    explicit uinput_scroll_sink(sink& fallback);
+    ~uinput_scroll_sink();
+
+    uinput_scroll_sink(const uinput_scroll_sink&) = delete;
+    uinput_scroll_sink& operator= (const uinput_scroll_sink&) = delete;
+
+    // Creates the virtual device. Returns false with errno set on failure.
+    bool open(const char* path = "/dev/uinput");
+
+    void move_pointer(int dx, int dy) override;
+    void warp_pointer(int x, int y) override;
+    void button(unsigned button, bool release) override;
+    void key(unsigned keysym, bool release, unsigned state) override;
+    void scroll(float horizontal, float vertical) override;
+
+private:
+    sink& fallback;
+    int fd;
+
+    // Sub-unit remainders and hi-res units not yet reported as a legacy
+    // notch, horizontal first.
+    float remainder[2];
+    int pending_notch_units[2];
+};
+
+// A virtual uinput mouse and keyboard, for seats without a display of
+// their own.
+//
+// Pointer buttons 1-3 and 8-9 become mouse buttons and 4-7 wheel notches.
+// Keysyms are translated through a fixed table of the keys bindings use
+// (letters, digits, function, editing, navigation and media keys); others
+// are dropped. A relative device cannot warp, so warp_pointer() does
+// nothing.
+class uinput_sink : public sink
+{
+public:
+    uinput_sink();
+    ~uinput_sink();
+
+    uinput_sink(const uinput_sink&) = delete;
+    uinput_sink& operator= (const uinput_sink&) = delete;
+
+    // Creates the virtual device. Returns false with errno set on failure.
+    bool open(const std::string& name, const char* path = "/dev/uinput");
+
+    void move_pointer(int dx, int dy) override;
+    void warp_pointer(int x, int y) override;
+    void button(unsigned button, bool release) override;
+    void key(unsigned keysym, bool release, unsigned state) override;
+    void scroll(float horizontal, float vertical) override;
+
+private:
+    int fd;
+    float remainder[2];
+    int pending_notch_units[2];
+};
+
+} // namespace output
+
+#endif // !defined(JOY2MOUSE_UINPUT_OUTPUT_HPP)
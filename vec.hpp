@@ -40,7 +40,7 @@ vec<T, N> operator+ (vec<T, N> left, vec<T, N> right)
 template <class T, std::size_t N>
 vec<T, N>& operator-= (vec<T, N>& left, vec<T, N> right)
 {
-    for (std::size_t i = 0; i < N; --i)
+    for (std::size_t i = 0; i < N; ++i)
     {
         left[i] -= right[i];
     }
@@ -121,6 +121,11 @@ struct vec
         return storage[i];
     }
 
+    const T& operator[] (std::size_t i) const
+    {
+        return storage[i];
+    }
+
     std::array<T, N> storage;
 };
 
@@ -0,0 +1,100 @@
+#include "trace.hpp"
+#include "x11_output.hpp"
+
+namespace output {
+
+void send_button_event(Display* dpy, unsigned button, bool release)
+{
+    JOY2MOUSE_TRACE_SCOPE_ARG("send_button_event", "button", button);
+
+    XEvent event = {};
+
+    event.type = ButtonPress;
+    event.xbutton.button = button;
+    event.xbutton.same_screen = True;
+    event.xbutton.subwindow = RootWindow(dpy, DefaultScreen(dpy));
+
+    if (release)
+    {
+        event.type = ButtonRelease;
+        event.xbutton.state = 0x100;
+    }
+
+    while (event.xbutton.subwindow)
+    {
+        event.xbutton.window = event.xbutton.subwindow;
+        XQueryPointer(dpy, event.xbutton.window, &event.xbutton.root,
+                      &event.xbutton.subwindow, &event.xbutton.x_root,
+                      &event.xbutton.y_root, &event.xbutton.x, &event.xbutton.y,
+                      &event.xbutton.state);
+    }
+
+    XSendEvent(dpy, PointerWindow, True, ButtonPressMask, &event);
+    XFlush(dpy);
+}
+
+void send_keyboard_event(Display* dpy, unsigned key, bool release, unsigned state)
+{
+    JOY2MOUSE_TRACE_SCOPE_ARG("send_keyboard_event", "keysym", key);
+
+    XEvent event = {};
+
+    Window focused_window;
+    int revert;
+    XGetInputFocus(dpy, &focused_window, &revert);
+
+    event.xkey.display = dpy;
+    event.xkey.window = focused_window;
+    event.xkey.root = RootWindow(dpy, DefaultScreen(dpy));
+    event.xkey.subwindow = None;
+    event.xkey.time = CurrentTime;
+    event.xkey.x = 1;
+    event.xkey.y = 1;
+    event.xkey.x_root = 1;
+    event.xkey.y_root = 1;
+    event.xkey.same_screen = True;
+    event.xkey.keycode = XKeysymToKeycode(dpy, key);
+    event.xkey.state = state;
+
+    event.type = release ? KeyRelease : KeyPress;
+
+    XSendEvent(dpy, focused_window, True, KeyPressMask, &event);
+    XFlush(dpy);
+}
+
+x11_sink::x11_sink(Display* dpy)
+    : dpy(dpy)
+{
+}
+
+void x11_sink::move_pointer(int dx, int dy)
+{
+    JOY2MOUSE_TRACE_SCOPE("warp_pointer");
+    XWarpPointer(dpy, None, None, 0, 0, 0, 0, dx, dy);
+    XSync(dpy, False);
+}
+
+void x11_sink::warp_pointer(int x, int y)
+{
+    JOY2MOUSE_TRACE_SCOPE("warp_pointer");
+    XWarpPointer(dpy, None, DefaultRootWindow(dpy), 0, 0, 0, 0, x, y);
+    XFlush(dpy);
+}
+
+void x11_sink::button(unsigned button, bool release)
+{
+    send_button_event(dpy, button, release);
+}
+
+void x11_sink::key(unsigned keysym, bool release, unsigned state)
+{
+    send_keyboard_event(dpy, keysym, release, state);
+}
+
+void x11_sink::scroll(float, float)
+{
+    // The core protocol only knows whole notches, which the translator
+    // produces as button clicks in discrete scroll mode.
+}
+
+} // namespace output
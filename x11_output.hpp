@@ -0,0 +1,35 @@
+#ifndef JOY2MOUSE_X11_OUTPUT_HPP
+#define JOY2MOUSE_X11_OUTPUT_HPP
+
+#include <X11/Xlib.h>
+
+#include "output.hpp"
+
+namespace output {
+
+void send_button_event(Display* dpy, unsigned button, bool release);
+void send_keyboard_event(Display* dpy, unsigned key, bool release,
+                         unsigned state = 0);
+
+// Synthesizes pointer, button and key events on an X display.
+class x11_sink : public sink
+{
+public:
+    explicit x11_sink(Display* dpy);
+
+    x11_sink(const x11_sink&) = delete;
+    x11_sink& operator= (const x11_sink&) = delete;
+
+    void move_pointer(int dx, int dy) override;
+    void warp_pointer(int x, int y) override;
+    void button(unsigned button, bool release) override;
+    void key(unsigned keysym, bool release, unsigned state) override;
+    void scroll(float horizontal, float vertical) override;
+
+private:
+    Display* dpy;
+};
+
+} // namespace output
+
+#endif // !defined(JOY2MOUSE_X11_OUTPUT_HPP)
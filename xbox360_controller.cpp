@@ -4,63 +4,51 @@
 
 namespace xbox360_controller {
 
-void input_state::process_dead_zone()
-{
-    const float left_stick_dead_zone = 7849;
-    const float right_stick_dead_zone = 8689;
-    const float trigger_threshold = 30;
+namespace {
 
-    float left_stick_magnitude = uncorrected.left_stick.length();
-    if (left_stick_magnitude >= left_stick_dead_zone)
-    {
-        float magnitude = (left_stick_magnitude - left_stick_dead_zone)
-            / (32767.0f - left_stick_dead_zone);
-        corrected.left_stick = magnitude
-            * uncorrected.left_stick.normalized();
-    }
-    else
+math::vec2f correct_stick(math::vec2f raw, math::vec2f center,
+                          float dead_zone)
+{
+    math::vec2f offset = raw - center;
+    float magnitude = offset.length();
+    if (magnitude >= dead_zone && magnitude > 0.0f)
     {
-        corrected.left_stick = {0.0f, 0.0f};
+        float scaled = (magnitude - dead_zone) / (32767.0f - dead_zone);
+        return scaled * offset.normalized();
     }
+    return { 0.0f, 0.0f };
+}
 
-    float right_stick_magnitude = uncorrected.right_stick.length();
-    if (right_stick_magnitude >= right_stick_dead_zone)
-    {
-        float magnitude = (right_stick_magnitude - right_stick_dead_zone)
-            / (32767.0f - right_stick_dead_zone);
-        corrected.right_stick = magnitude
-            * uncorrected.right_stick.normalized();
-    }
-    else
+// Triggers resting at one end of the axis use the whole range.
+float correct_trigger(float raw, float rest, float threshold)
+{
+    float offset = raw - rest;
+    float magnitude = std::abs(offset);
+    if (magnitude >= threshold)
     {
-        corrected.right_stick = {0.0f, 0.0f};
+        float range = 32767.0f + std::abs(rest);
+        float scaled = (magnitude - threshold) / (range - threshold);
+        return std::copysign(scaled, offset);
     }
+    return 0.0f;
+}
 
-    float left_trigger_magnitude = std::abs(uncorrected.left_trigger);
-    if (left_trigger_magnitude >= trigger_threshold)
-    {
-        float magnitude = (left_trigger_magnitude - trigger_threshold)
-            / (32767.0f - trigger_threshold);
-        corrected.left_trigger =
-            std::copysign(magnitude, uncorrected.left_trigger);
-    }
-    else
-    {
-        corrected.left_trigger = 0.0f;
-    }
+} // namespace
 
-    float right_trigger_magnitude = std::abs(uncorrected.right_trigger);
-    if (right_trigger_magnitude >= trigger_threshold)
-    {
-        float magnitude = (right_trigger_magnitude - trigger_threshold)
-            / (32767.0f - trigger_threshold);
-        corrected.right_trigger =
-            std::copysign(magnitude, uncorrected.right_trigger);
-    }
-    else
-    {
-        corrected.right_trigger = 0.0f;
-    }
+void input_state::process_dead_zone()
+{
+    const dead_zones& c = calibration;
+
+    corrected.left_stick = correct_stick(
+        uncorrected.left_stick, c.left_stick_center, c.left_stick);
+    corrected.right_stick = correct_stick(
+        uncorrected.right_stick, c.right_stick_center, c.right_stick);
+    corrected.left_trigger = correct_trigger(
+        uncorrected.left_trigger, c.left_trigger_rest,
+        c.left_trigger_threshold);
+    corrected.right_trigger = correct_trigger(
+        uncorrected.right_trigger, c.right_trigger_rest,
+        c.right_trigger_threshold);
 }
 
 std::string to_string(button button)
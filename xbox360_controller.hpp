@@ -1,6 +1,7 @@
 #ifndef JOY2MOUSE_XBOX360_CONTROLLER_HPP
 #define JOY2MOUSE_XBOX360_CONTROLLER_HPP
 
+#include <cstddef>
 #include <string>
 
 #include "vec.hpp"
@@ -22,6 +23,8 @@ enum class button
     right_stick
 };
 
+constexpr std::size_t button_count = std::size_t(button::right_stick) + 1;
+
 enum class axis
 {
     left_stick_x,
@@ -34,9 +37,15 @@ enum class axis
     dpad_y
 };
 
+constexpr std::size_t axis_count = std::size_t(axis::dpad_y) + 1;
+
 std::string to_string(button button);
 std::string to_string(axis axis);
 
+// Raw value of a released trigger. joydev reports triggers over the whole
+// axis, and every other trigger source is mapped to the same range.
+constexpr float trigger_released = -32767;
+
 struct analog_state
 {
     math::vec2f left_stick;
@@ -45,16 +54,34 @@ struct analog_state
     float right_trigger;
 };
 
+// Resting positions and dead zones of the analog inputs, in raw units. The
+// defaults are the values from the Xbox 360 controller specification.
+struct dead_zones
+{
+    math::vec2f left_stick_center = { 0.0f, 0.0f };
+    math::vec2f right_stick_center = { 0.0f, 0.0f };
+    float left_stick = 7849;
+    float right_stick = 8689;
+
+    float left_trigger_rest = trigger_released;
+    float right_trigger_rest = trigger_released;
+    float left_trigger_threshold = 30;
+    float right_trigger_threshold = 30;
+};
+
 struct input_state
 {
     void process_dead_zone();
 
-    analog_state uncorrected;
-    analog_state corrected;
-    math::vec2f dpad;
+    dead_zones calibration = {};
+
+    analog_state uncorrected = {
+        { 0.0f, 0.0f }, { 0.0f, 0.0f }, trigger_released, trigger_released };
+    analog_state corrected = {};
+    math::vec2f dpad = {};
 
-    bool left_stick_down;
-    bool right_stick_down;
+    bool left_stick_down = false;
+    bool right_stick_down = false;
 };
 
 } // namespace xbox360_controller